@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace yael
+{
+
+/**
+ * @brief A move-only callable that never allocates
+ *
+ * Similar to std::function<void()>, but the callable is always stored inline.
+ * Callables that do not fit will fail to compile; wrap them in a std::function
+ * (or a std::unique_ptr) if you need more space.
+ */
+class Closure
+{
+public:
+    static constexpr size_t STORAGE_SIZE = 48;
+
+    Closure() noexcept = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Closure>>>
+    explicit Closure(F &&func) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F&&>)
+    {
+        using func_t = std::decay_t<F>;
+
+        static_assert(sizeof(func_t) <= STORAGE_SIZE, "Callable is too large for a Closure");
+        static_assert(alignof(func_t) <= alignof(std::max_align_t), "Callable is over-aligned");
+        static_assert(std::is_nothrow_move_constructible_v<func_t>, "Callable needs a noexcept move constructor");
+
+        new (&m_storage) func_t(std::forward<F>(func));
+        m_ops = &ops_for<func_t>;
+    }
+
+    Closure(Closure &&other) noexcept
+    {
+        move_from(other);
+    }
+
+    Closure& operator=(Closure &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            move_from(other);
+        }
+
+        return *this;
+    }
+
+    Closure(const Closure &other) = delete;
+    Closure& operator=(const Closure &other) = delete;
+
+    ~Closure()
+    {
+        reset();
+    }
+
+    /// Does this hold a callable?
+    explicit operator bool() const noexcept
+    {
+        return m_ops != nullptr;
+    }
+
+    void operator()()
+    {
+        m_ops->invoke(&m_storage);
+    }
+
+    /// Destroy the held callable (if any)
+    void reset() noexcept
+    {
+        if (m_ops != nullptr)
+        {
+            m_ops->destroy(&m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct ops_t
+    {
+        void (*invoke)(void *storage);
+        void (*move)(void *dst, void *src) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template<typename T>
+    static constexpr ops_t ops_for = {
+        [](void *storage) { (*static_cast<T*>(storage))(); },
+        [](void *dst, void *src) noexcept { new (dst) T(std::move(*static_cast<T*>(src))); },
+        [](void *storage) noexcept { static_cast<T*>(storage)->~T(); }
+    };
+
+    void move_from(Closure &other) noexcept
+    {
+        if (other.m_ops != nullptr)
+        {
+            other.m_ops->move(&m_storage, &other.m_storage);
+            m_ops = other.m_ops;
+            other.reset();
+        }
+    }
+
+    const ops_t *m_ops = nullptr;
+    alignas(std::max_align_t) std::byte m_storage[STORAGE_SIZE];
+};
+
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "EventLoop.h"
+#include "NetworkSocketListener.h"
+#include "network/Address.h"
+
+namespace yael
+{
+
+/**
+ * @brief A coroutine that runs detached, e.g., to handle a single connection
+ *
+ * The coroutine starts right away on the calling thread.
+ * Once it waits for something (e.g., a message or a timer) it is resumed by the worker thread that handles the
+ * corresponding event. Its state is freed when it returns.
+ */
+class Task
+{
+public:
+    struct promise_type
+    {
+        Task get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        /// Exceptions cannot be passed to anybody, so they are logged
+        void unhandled_exception() noexcept;
+    };
+};
+
+/**
+ * Resumes the coroutine once the duration has passed (see EventLoop::sleep)
+ * If the event loop stops before that, the coroutine is destroyed without being resumed.
+ */
+class SleepAwaitable
+{
+public:
+    SleepAwaitable(EventLoop &event_loop, std::chrono::nanoseconds duration)
+        : m_event_loop(event_loop), m_duration(duration)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return m_duration.count() <= 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept {}
+
+private:
+    EventLoop &m_event_loop;
+    std::chrono::nanoseconds m_duration;
+};
+
+inline SleepAwaitable EventLoop::sleep(std::chrono::nanoseconds duration)
+{
+    return {*this, duration};
+}
+
+/**
+ * @brief A connection that is used from a coroutine
+ *
+ * Only one coroutine should receive from (and one send to) the connection at a time.
+ */
+class AsyncConnection : public NetworkSocketListener
+{
+public:
+    class ReceiveAwaitable
+    {
+    public:
+        explicit ReceiveAwaitable(AsyncConnection &connection) : m_connection(connection) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle);
+
+        /// @note the caller owns the message's data and has to delete[] it
+        std::optional<network::message_in_t> await_resume();
+
+    private:
+        AsyncConnection &m_connection;
+    };
+
+    class SendAwaitable
+    {
+    public:
+        SendAwaitable(AsyncConnection &connection, std::unique_ptr<uint8_t[]> &&data, size_t length)
+            : m_connection(connection), m_data(std::move(data)), m_length(length)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle);
+
+        /// @return false if the connection was closed
+        bool await_resume();
+
+    private:
+        AsyncConnection &m_connection;
+        std::unique_ptr<uint8_t[]> m_data;
+        size_t m_length;
+    };
+
+    explicit AsyncConnection(std::unique_ptr<network::Socket> &&socket);
+
+    /// Construct without a socket (see connect())
+    AsyncConnection();
+
+    ~AsyncConnection() override;
+
+    /**
+     * Wait for the next message
+     * @return the message or an empty optional once the connection is closed
+     */
+    ReceiveAwaitable receive()
+    {
+        return ReceiveAwaitable(*this);
+    }
+
+    /**
+     * Send a message and wait until it (and everything queued before it) has been handed to the kernel
+     * @return false if the connection was closed
+     */
+    SendAwaitable send(std::unique_ptr<uint8_t[]> &&data, size_t length)
+    {
+        return SendAwaitable(*this, std::move(data), length);
+    }
+
+    /// Same as send(std::unique_ptr) but copies the data first
+    SendAwaitable send(const uint8_t *data, size_t length);
+
+protected:
+    void on_network_message(network::message_in_t &msg) override;
+    void on_disconnect() override;
+    void on_send_queue_drained() override;
+    void on_connected() override;
+    void on_connect_failed() override;
+
+private:
+    friend class ConnectAwaitable;
+
+    std::mutex m_coroutine_mutex;
+
+    /// Messages that have not been picked up by receive() yet
+    std::deque<network::message_in_t> m_messages;
+
+    bool m_disconnected = false;
+    bool m_connect_failed = false;
+
+    /// The coroutines waiting (if any)
+    std::coroutine_handle<> m_receiver = nullptr;
+    std::coroutine_handle<> m_sender = nullptr;
+    std::coroutine_handle<> m_connector = nullptr;
+
+    /// Distinguishes sends of the same coroutine
+    uint64_t m_num_sends = 0;
+};
+
+/// Resumes the coroutine once the connection is established (or connecting failed)
+class ConnectAwaitable
+{
+public:
+    ConnectAwaitable(EventLoop &event_loop, const network::Address &address, std::chrono::milliseconds timeout)
+        : m_event_loop(event_loop), m_address(address), m_timeout(timeout)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    /// @return the connection (registered with the event loop), or nullptr if connecting failed
+    std::shared_ptr<AsyncConnection> await_resume();
+
+private:
+    EventLoop &m_event_loop;
+    network::Address m_address;
+    std::chrono::milliseconds m_timeout;
+
+    std::shared_ptr<AsyncConnection> m_connection = nullptr;
+};
+
+/**
+ * Open a TCP connection to the specified address without blocking the thread
+ * @param timeout give up if the connection is not established in time (zero means no timeout)
+ */
+inline ConnectAwaitable connect(EventLoop &event_loop, const network::Address &address,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+{
+    return {event_loop, address, timeout};
+}
+
+}
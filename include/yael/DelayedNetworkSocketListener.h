@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include <list>
+#include <mutex>
 #include <tuple>
 
 #include "NetworkSocketListener.h"
@@ -35,10 +36,16 @@ public:
 
     void close_socket() override;
 
-protected:
-    void set_socket(std::unique_ptr<network::Socket> &&socket, SocketType type) override;
+    /// Also waits for delayed messages to be sent
+    bool is_drained() override;
+
+    void force_close() override;
 
 private:
+    /// Creates the sender on first use, so it is registered with the same event loop as this listener
+    std::shared_ptr<DelayedMessageSender> get_sender();
+
+    std::mutex m_sender_mutex;
     std::shared_ptr<DelayedMessageSender> m_sender;
     uint32_t m_delay;
 };
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <glog/logging.h>
 
 namespace yael
 {
 
+class EventLoop;
+
 class EventListener : public std::enable_shared_from_this<EventListener>
 {
 public:
@@ -40,6 +43,36 @@ public:
 
     virtual void close_socket() = 0;
 
+    /**
+     * The event loop is draining (see EventLoop::stop with a deadline)
+     * Stop taking on new work, e.g., by closing listening sockets. Ongoing work should continue.
+     */
+    virtual void on_drain() {}
+
+    /**
+     * Has all outstanding work (e.g. queued data) completed?
+     * The event loop closes drained listeners with close_socket() while it is shutting down gracefully.
+     */
+    virtual bool is_drained() { return true; }
+
+    /**
+     * Close right away, discarding any outstanding work
+     * Used for listeners that did not drain before the shutdown deadline.
+     */
+    virtual void force_close() { close_socket(); }
+
+    /// Does this listener use edge-triggered notifications? (see set_edge_triggered)
+    bool is_edge_triggered() const noexcept
+    {
+        return m_edge_triggered;
+    }
+
+    /// The event loop this listener is registered with (if any)
+    EventLoop* event_loop() const noexcept
+    {
+        return m_event_loop;
+    }
+
     static const char* mode_to_string(Mode &mode) {
         switch(mode) {
             case Mode::ReadOnly: return "read-only";
@@ -50,6 +83,46 @@ public:
 
 protected:
     EventListener() = default;
+
+    /**
+     * Stay registered for events instead of re-arming the listener after each of them
+     *
+     * The event loop still ensures only one thread handles events of this listener at a time.
+     * Callbacks have to consume all available data (until EAGAIN), as they will only be invoked again once there is new data.
+     *
+     * @note must be set before registering the listener
+     */
+    void set_edge_triggered(bool enabled) noexcept
+    {
+        m_edge_triggered = enabled;
+    }
+
+    /**
+     * Stop handling input for now and invoke on_read_ready() again once other ready listeners have been served
+     * The listener is not re-armed in the meantime, so no other thread will handle its events.
+     *
+     * @note must only be called from within on_read_ready()
+     */
+    void defer_read() noexcept
+    {
+        m_read_deferred = true;
+    }
+
+private:
+    friend class EventLoop;
+
+    std::atomic<EventLoop*> m_event_loop = nullptr;
+
+    bool m_edge_triggered = false;
+
+    /// Set by defer_read(); only accessed by the thread handling the listener
+    bool m_read_deferred = false;
+
+    /// Ownership flag (set while a worker handles the listener) and pending events (only used in edge-triggered mode)
+    std::atomic<uint32_t> m_event_state = 0;
+
+    /// The shard of the event loop this listener is registered with
+    std::atomic<int32_t> m_shard = -1;
 };
 
 using EventListenerPtr = std::shared_ptr<EventListener>;
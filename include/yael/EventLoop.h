@@ -1,27 +1,160 @@
 #pragma once
 
 #include <thread>
-#include <unordered_map>
-#include <shared_mutex>
-#include <condition_variable>
 #include <atomic>
-#include <list>
+#include <chrono>
+#include <mutex>
+#include <vector>
 #include <cstdint>
+#include <functional>
+#include <limits>
 
+#include "Closure.h"
 #include "EventListener.h"
+#include "Pool.h"
+#include "Stats.h"
+
+struct epoll_event;
 
 namespace yael
 {
 
+class ListenerTable;
+class Poller;
+class TaskQueue;
+class TimerWheel;
+class WorkerStats;
+class SleepAwaitable;
+
+/// How listeners are distributed across shards
+enum class ShardPolicy
+{
+    RoundRobin,
+    LeastLoaded
+};
+
+/// The kernel interface used to wait for events
+enum class EventBackend
+{
+    Epoll,
+    IoUring
+};
+
+/// The clocks EventLoop::get_time can be based on
+enum class ClockSource
+{
+    /// CLOCK_MONOTONIC (same as std::chrono::steady_clock)
+    Monotonic,
+
+    /// CLOCK_MONOTONIC_COARSE: cheaper to read, but only advances every few milliseconds
+    MonotonicCoarse
+};
+
+/// Settings for EventLoop::initialize
+struct event_loop_config_t
+{
+    /// Amount of worker threads. By default (-1) it will estimate based on CPU cores available
+    int32_t num_threads = -1;
+
+    /**
+     * Elastic mode (0 to disable): start with this many worker threads and add more, up to num_threads,
+     * whenever all of them are busy. Additional workers terminate once they have been idle for idle_timeout.
+     * Not supported in sharded mode.
+     */
+    int32_t min_threads = 0;
+
+    /// Only used in elastic mode
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(5);
+
+    /// Maximum number of events a worker harvests per wakeup
+    int32_t max_events = 1;
+
+    /**
+     * Give every worker thread its own epoll instance and listener table.
+     * Listeners stay with the shard they were registered with.
+     */
+    bool sharded = false;
+
+    /// Only used in sharded mode
+    ShardPolicy shard_policy = ShardPolicy::RoundRobin;
+
+    /**
+     * io_uring batches re-arming listeners with waiting for the next events.
+     * It can only be used by one thread at a time, so this implies sharded mode.
+     * Falls back to epoll if the kernel does not support it.
+     */
+    EventBackend backend = EventBackend::Epoll;
+
+    /**
+     * Pin worker threads to these CPUs (in round-robin order).
+     * If set, there will be one thread per CPU by default.
+     */
+    std::vector<int32_t> cpus = {};
+
+    /**
+     * Pin worker threads to the CPUs of this NUMA node (-1 to disable) and prefer allocating memory on it.
+     * Ignored if cpus is set.
+     */
+    int32_t numa_node = -1;
+
+    /**
+     * Before blocking, poll for events without waiting for up to this many microseconds (0 to disable).
+     * This trades CPU time for lower wakeup latency and works best in sharded mode.
+     */
+    uint32_t busy_poll_us = 0;
+
+    /**
+     * Record how long listener callbacks take and how long events wait to be dispatched (see EventLoop::stats).
+     * This requires reading the clock twice per event. Event counts are always collected.
+     */
+    bool measure_latency = false;
+
+    /**
+     * Maximum number of messages a network listener handles per event (0 for no limit)
+     * Once the budget is used up, the listener yields to other ready listeners and resumes afterwards.
+     * This keeps a single busy connection from occupying a worker thread.
+     */
+    uint32_t read_budget = 0;
+
+    /**
+     * Block asynchronous signals (e.g., SIGTERM) in worker threads, so they never interrupt a worker.
+     * They are delivered to other threads instead, or can be received using a SignalEventListener.
+     */
+    bool block_signals = true;
+
+    /// The clock worker threads read whenever they wake up (see EventLoop::get_time)
+    ClockSource clock_source = ClockSource::Monotonic;
+
+    /**
+     * Granularity of time events (see TimeEventListener)
+     * Finer resolutions allow sub-millisecond timers, but may wake up workers more often.
+     */
+    std::chrono::nanoseconds timer_resolution = std::chrono::milliseconds(1);
+};
+
 /**
  * @brief The main EventLoop class
- * @note This is a singleton. A process should only have one event loop.
+ *
+ * Most applications use a single, global event loop (see initialize() and get_instance()).
+ * Additional independent event loops, each with their own worker threads, can be created using create().
+ * Event listeners always use the event loop they are registered with.
  */
 class EventLoop
 {
 public:
     EventLoop(const EventLoop &other) = delete;
 
+    /**
+     * Stops the event loop (if needed) and waits for all worker threads to terminate
+     * @note must not be called from within an event listener
+     */
+    ~EventLoop();
+
+    /**
+     * @brief Create a new event loop that is independent of the global instance and start its worker threads
+     */
+    static std::unique_ptr<EventLoop> create(const event_loop_config_t &config);
+
     /**
      * @brief wait for event loop to terminate
      *
@@ -29,37 +162,134 @@ public:
      */
     void wait() noexcept;
 
+    /// Create a listener (without registering it). Its memory is pooled (see pool_allocate)
     template<typename T, typename... Args>
     std::shared_ptr<T> allocate_event_listener(Args&&... args)
     {
-        return std::make_shared<T>(std::forward<Args>(args)...);
+        return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
     }
-    
+
+    /// Create a listener and register it
     template<typename T, typename... Args>
     std::shared_ptr<T> make_event_listener(Args&&... args)
     {
-        auto l = std::make_shared<T>(std::forward<Args>(args)...);
-        auto sl = std::dynamic_pointer_cast<EventListener>(l);
+        auto l = allocate_event_listener<T>(std::forward<Args>(args)...);
 
-        this->register_event_listener(sl);
+        this->register_event_listener(l);
         return l;
     }
 
     void register_event_listener(EventListenerPtr listener) noexcept;
 
+    /**
+     * Register the listener with a specific shard
+     * This allows, for example, to have one SO_REUSEPORT acceptor per shard (see make_reuse_port_acceptors).
+     * The shard index wraps around if it exceeds num_shards().
+     */
+    void register_event_listener(EventListenerPtr listener, size_t shard) noexcept;
+
+    /**
+     * Create one acceptor per shard and register each of them with its shard
+     *
+     * The constructor of T has to listen with a TcpSocket that has SO_REUSEPORT set (see TcpSocket::set_reuse_port),
+     * so the kernel spreads incoming connections over all acceptors.
+     * Connections accepted by such an acceptor stay on its shard (see LocalShardScope).
+     */
+    template<typename T, typename... Args>
+    std::vector<std::shared_ptr<T>> make_reuse_port_acceptors(const Args&... args)
+    {
+        std::vector<std::shared_ptr<T>> result;
+        result.reserve(num_shards());
+
+        for(size_t shard = 0; shard < num_shards(); ++shard)
+        {
+            auto l = allocate_event_listener<T>(args...);
+
+            this->register_event_listener(l, shard);
+            result.push_back(std::move(l));
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Keeps listeners registered by the current worker thread on its shard
+     *
+     * While it exists, listeners that are registered without an explicit shard go to the shard of the calling
+     * worker, just like time event listeners set up by a handler do. This has no effect on other threads.
+     */
+    class LocalShardScope
+    {
+    public:
+        explicit LocalShardScope(bool enabled = true) noexcept
+            : m_previous(m_keep_local)
+        {
+            m_keep_local = m_previous || enabled;
+        }
+
+        ~LocalShardScope()
+        {
+            m_keep_local = m_previous;
+        }
+
+        LocalShardScope(const LocalShardScope &other) = delete;
+        LocalShardScope& operator=(const LocalShardScope &other) = delete;
+
+    private:
+        const bool m_previous;
+    };
+
+    /**
+     * Run a function on one of the worker threads
+     *
+     * When called from a worker thread, the task will run on the same shard.
+     * Tasks that have not run yet when the event loop is stopped are dropped.
+     *
+     * @return false if the event loop is shutting down
+     */
+    bool post(std::function<void()> func);
+
+    /**
+     * Same as post(std::function) but does not allocate (unless the task queue is full)
+     * @return false if the event loop is shutting down or there was not enough memory to queue the task
+     */
+    bool post(Closure &&task) noexcept;
+
+    /**
+     * Suspend the calling coroutine for the specified duration
+     * It will be resumed by one of the worker threads.
+     *
+     * @note defined in Coroutine.h
+     */
+    SleepAwaitable sleep(std::chrono::nanoseconds duration);
+
     /**
      * Shut the event loop down. This will stop all active event listeners
      * Note that this must be called from outside an event listener to avoid a deadlock!
      */
     void stop() noexcept;
 
+    /**
+     * Shut the event loop down gracefully
+     *
+     * Listeners first get to stop accepting new work (see EventListener::on_drain).
+     * The workers keep running, so queued data can still be sent, and listeners are closed once they are drained.
+     * Listeners that have not drained by the deadline are closed forcefully.
+     *
+     * Note that this must be called from outside an event listener to avoid a deadlock!
+     */
+    void stop(std::chrono::steady_clock::time_point deadline) noexcept;
+
+    /// Same as stop(deadline) with a deadline timeout from now
+    void stop(std::chrono::milliseconds timeout) noexcept;
+
     /**
      * Is the event loop running and not about to be shut down?
      */
     bool is_okay() const noexcept;
 
     /**
-     * @brief get the instance of the singleton
+     * @brief get the global instance
      * @throws a runtime_error if it hasn't been intialized yet
      */
     static EventLoop& get_instance();
@@ -68,8 +298,16 @@ public:
      * @brief Initializes the event loop
      * @param num_threads
      *		amount of threads. By default (-1) it will estimate based on CPU cores avaiable
+     * @param max_events
+     *      maximum number of events a worker harvests per wakeup.
+     *      Each listener is still only handled by one thread at a time.
+     */
+    static void initialize(int32_t num_threads = -1, int32_t max_events = 1) noexcept;
+
+    /**
+     * @brief Initializes the event loop with the specified configuration
      */
-    static void initialize(int32_t num_threads = -1) noexcept;
+    static void initialize(const event_loop_config_t &config) noexcept;
 
     /**
      * @brief destroys the event loop instance. it is safe to call this multiple times.
@@ -77,12 +315,64 @@ public:
      */
     static void destroy() noexcept;
 
+    /// The backend that is actually in use (see event_loop_config_t::backend)
+    EventBackend backend() const noexcept
+    {
+        return m_backend;
+    }
+
+    /// The number of messages a listener may handle per event (see event_loop_config_t::read_budget)
+    uint32_t read_budget() const noexcept
+    {
+        return m_config.read_budget;
+    }
+
+    /// The number of shards (1 if the event loop is not sharded)
+    size_t num_shards() const noexcept
+    {
+        return m_shards.size();
+    }
+
+    /// The number of worker threads that are currently running (see event_loop_config_t::min_threads)
+    size_t num_workers() const noexcept
+    {
+        return m_num_workers;
+    }
+
+    /**
+     * Get a snapshot of the statistics of every worker thread
+     * In elastic mode, there is one entry for each worker that might run (some of which may not be running).
+     */
+    event_loop_stats_t stats() const;
+
     /**
      * Get relative local time (in milliseconds)
+     *
+     * Worker threads read the clock once whenever they wake up, so handlers (and posted tasks) get the time
+     * their batch of events arrived without another clock read. Other threads always read the clock.
      */
     uint64_t get_time() const;
 
-    void notify_listener_mode_change(EventListenerPtr listener, EventListener::Mode mode, bool first_time) noexcept;
+    /// Same as get_time() but in nanoseconds
+    uint64_t get_time_ns() const;
+
+    /**
+     * Read the clock again
+     * If called from a worker thread, its cached time is updated as well (e.g., after a long-running handler).
+     * @return the current time in nanoseconds
+     */
+    uint64_t update_time();
+
+    /// Re-arm (or first register) the listener's fileno with the mode's flags
+    /// @note takes a reference so listeners do not have to touch their reference count on every event
+    void notify_listener_mode_change(EventListener &listener, EventListener::Mode mode, bool first_time) noexcept;
+
+    void notify_listener_mode_change(const EventListenerPtr &listener, EventListener::Mode mode,
+                                     bool first_time) noexcept
+    {
+        notify_listener_mode_change(*listener, mode, first_time);
+    }
+
     void unregister_event_listener(EventListenerPtr listener) noexcept;
 
     static bool is_initialized() noexcept
@@ -91,8 +381,9 @@ public:
     }
 
 private:
-    explicit EventLoop(int32_t num_threads);
-    ~EventLoop();
+    friend class TimeEventListener;
+
+    explicit EventLoop(const event_loop_config_t &config);
 
     void run() noexcept;
     
@@ -105,29 +396,167 @@ private:
         Error
     };
     
-    std::pair<EventListenerPtr, EventType> update();
-    
-    void thread_loop();
+    /// Listeners are borrowed from the shard's table (see update)
+    using event_t = std::pair<EventListener*, EventType>;
+
+    static EventType get_event_type(uint32_t flags);
+
+    /**
+     * An epoll instance (or io_uring) together with the listeners registered with it
+     * In sharded mode every worker thread has its own shard
+     */
+    struct shard_t
+    {
+        shard_t(size_t num_threads, std::unique_ptr<Poller> &&poller, std::chrono::nanoseconds timer_resolution);
+        ~shard_t();
+
+        const std::unique_ptr<Poller> poller;
+
+        /// Used to wake up workers for posted tasks
+        const int32_t event_semaphore;
+
+        const std::unique_ptr<TaskQueue> tasks;
 
-    void register_socket(int32_t fileno, uint32_t flags, bool modify = false);
+        /// Mapping from the filedescriptor to the event listener
+        /// Every worker thread of the shard is a reader of this table
+        std::unique_ptr<ListenerTable> event_listeners;
 
-    void unregister_socket(int32_t fileno);
+        /// Drives the time event listeners registered with this shard
+        const std::unique_ptr<TimerWheel> timers;
+
+        /// All listeners, including time event listeners
+        std::vector<EventListenerPtr> snapshot() const;
+
+        size_t num_listeners() const;
+    };
+
+    /**
+     * Wait for the next batch of events and append them to events
+     *
+     * The listeners are not reference counted. Instead, if events are returned, the calling thread stays in
+     * the listener table's epoch and has to call event_listeners->exit(reader) once it has handled them.
+     * Time event listeners are not in the table; references to those that expired are kept in expired.
+     *
+     * @param reader the index of the calling thread within its shard
+     * @param stats the statistics of the calling worker
+     * @param block wait until there are events (otherwise only check for them)
+     * @param timeout give up waiting after this many milliseconds (-1 to wait indefinitely)
+     * @return false if the calling thread should terminate
+     */
+    bool update(shard_t &shard, size_t reader, epoll_event *raw_events, std::vector<event_t> &events,
+                std::vector<EventListenerPtr> &expired, WorkerStats &stats, bool block = true,
+                int32_t timeout = -1);
+
+    /**
+     * Poll for events without blocking until some arrive or busy_poll_us have passed
+     * @return the number of events (or -1 on error)
+     */
+    int busy_poll(shard_t &shard, epoll_event *raw_events);
+
+    /// @param worker the index of the worker thread
+    void thread_loop(shard_t &shard, size_t reader, size_t worker);
+
+    /// The CPU the worker with the specified index should run on (or -1)
+    int32_t get_worker_cpu(size_t worker) const;
+
+    static void dispatch(EventListener &listener, EventType type);
+
+    /**
+     * Handle events of a listener that does not use EPOLLONESHOT
+     * If another thread is already handling the listener, the events are handed to that thread instead.
+     *
+     * @param resume continue a read that was deferred earlier (the calling thread already owns the listener)
+     * @return true if the listener deferred reading and the calling thread still owns it
+     */
+    static bool dispatch_edge_triggered(EventListener &listener, EventType type, bool resume = false);
+
+    /**
+     * Run tasks that were posted to this shard
+     * @return false if there were none
+     */
+    bool run_tasks(shard_t &shard, WorkerStats &stats);
+
+    /// Start a worker thread for the specified slot (must hold m_threads_mutex)
+    void start_worker(size_t worker);
+
+    /// Elastic mode: start another worker, unless the maximum is reached or another one is starting already
+    void spawn_worker() noexcept;
+
+    /// Elastic mode: let an idle worker terminate, unless only min_threads are left
+    bool retire_worker(size_t worker) noexcept;
+
+    /**
+     * Pick the shard a new listener will be registered with
+     * @param preferred the shard to use, or -1 to decide based on the shard policy
+     */
+    int32_t select_shard(int32_t fileno, int32_t preferred = -1);
+
+    void add_event_listener(EventListenerPtr listener, int32_t shard_idx);
+
+    void register_socket(shard_t &shard, int32_t fileno, uint32_t flags, bool modify = false);
+
+    /// Close all listeners that are left and make the workers terminate
+    void shut_down() noexcept;
+
+    /// Read the configured clock (in nanoseconds)
+    uint64_t read_clock() const;
+
+    /// The timing wheel of the shard the (time event) listener is registered with
+    TimerWheel& get_timer_wheel(const EventListener &listener);
 
     static EventLoop* m_instance;
 
     std::atomic<bool> m_okay;
 
-    std::list<std::thread> m_threads;
+    /// Set while stop(deadline) waits for listeners to drain
+    std::atomic<bool> m_draining = false;
+
+    /// The deadline passed to stop() in nanoseconds (see get_time_ns)
+    std::atomic<uint64_t> m_drain_deadline = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Written once, when the event loop shuts down
+     * Registered level-triggered with every shard, so all workers wake up at the same time.
+     */
+    int32_t m_shutdown_fd;
+
+    /// Indexed by worker; in elastic mode, some threads may not be running
+    std::vector<std::thread> m_threads;
+    std::vector<bool> m_worker_active;
+    std::mutex m_threads_mutex;
+
+    bool m_elastic = false;
+    std::atomic<int32_t> m_num_workers = 0;
+
+    /// Workers that are waiting for events
+    std::atomic<int32_t> m_num_idle = 0;
+
+    /// Set while a new worker starts, so workers do not spawn more than one at a time
+    std::atomic<bool> m_spawning = false;
+
+    std::vector<std::unique_ptr<shard_t>> m_shards;
+    std::atomic<size_t> m_next_shard = 0;
+    std::atomic<size_t> m_next_task_shard = 0;
+
+    /// The event loop and shard the current thread is a worker of (if any)
+    static thread_local EventLoop *m_current_loop;
+    static thread_local shard_t *m_current_shard;
+
+    /// Set by LocalShardScope
+    static thread_local bool m_keep_local;
+
+    /// When the current worker thread last woke up (see get_time)
+    static thread_local uint64_t m_loop_time;
 
-    std::shared_mutex m_event_listeners_mutex;
-    std::condition_variable_any m_event_listeners_cond;
+    event_loop_config_t m_config;
+    int32_t m_num_threads;
 
-    /// Mapping from the filedescriptor to the event listener
-    std::unordered_map<int32_t, EventListenerPtr> m_event_listeners;
+    /// CPUs to pin workers to (if any)
+    std::vector<int32_t> m_cpus;
 
-    const int32_t m_epoll_fd;
-    const int32_t m_event_semaphore;
-    const int32_t m_num_threads;
+    /// One entry per worker thread
+    std::vector<std::unique_ptr<WorkerStats>> m_worker_stats;
+    EventBackend m_backend;
 };
 
 inline EventLoop& EventLoop::get_instance()
@@ -142,7 +571,7 @@ inline EventLoop& EventLoop::get_instance()
 
 inline bool EventLoop::is_okay() const noexcept
 {
-    return m_okay;
+    return m_okay && !m_draining;
 }
 
 }
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+
+#include "EventListener.h"
+
+namespace yael
+{
+
+/**
+ * @brief Watches an arbitrary pollable file descriptor (e.g., a pipe, eventfd, inotify instance, or pidfd)
+ *
+ * Callbacks run on a worker thread, and never concurrently for the same listener (unless it is edge-triggered).
+ * Like other listeners, it is re-armed after every event, until it is closed.
+ */
+class FdEventListener : public EventListener
+{
+public:
+    using Callback = std::function<void(FdEventListener &listener)>;
+
+    /**
+     * @param fd the file descriptor; the listener closes it, unless owns_fd is false
+     * @param on_readable invoked when the fd is readable, or the other end hung up.
+     *        If there is none, both are treated as errors (see on_error).
+     * @param on_writable invoked when the fd is writable (only in read-write mode, see set_mode)
+     * @param on_error invoked on errors; the listener is closed afterwards
+     */
+    FdEventListener(int32_t fd, Callback on_readable, Callback on_writable = {}, Callback on_error = {},
+                    bool owns_fd = true);
+
+    ~FdEventListener() override;
+
+    FdEventListener(const FdEventListener &other) = delete;
+
+    /// The watched file descriptor (or -1 if it was closed)
+    int32_t fd()
+    {
+        const std::unique_lock lock(m_mutex);
+        return m_fd;
+    }
+
+    /**
+     * Watch for the fd to become writable as well (read-write), or not (read-only)
+     * Most fds are writable almost all the time, so only enable this while there is something to write.
+     */
+    void set_mode(EventListener::Mode mode);
+
+    /// Stop watching the fd (and close it, if the listener owns it)
+    void close_socket() override;
+
+    bool is_valid() final
+    {
+        const std::unique_lock lock(m_mutex);
+        return m_fd >= 0;
+    }
+
+    void re_register(bool first_time) override;
+
+    using EventListener::set_edge_triggered;
+
+private:
+    int32_t get_fileno() const final
+    {
+        return m_fileno;
+    }
+
+    void on_read_ready() final;
+    void on_write_ready() final;
+    void on_error() final;
+
+    const int32_t m_fileno;
+    int32_t m_fd;
+    const bool m_owns_fd;
+
+    Callback m_on_readable;
+    Callback m_on_writable;
+    Callback m_on_error;
+
+    std::mutex m_mutex;
+    EventListener::Mode m_mode = EventListener::Mode::ReadOnly;
+};
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <memory>
 #include <glog/logging.h>
@@ -48,11 +50,39 @@ public:
 
     void wait_for_connection();
 
+    /**
+     * @brief Connect to the address without blocking
+     *
+     * The listener must not have a socket yet and should be registered with the event loop afterwards.
+     * on_connected() is invoked once the connection (including the TLS handshake, if any) is established.
+     * Otherwise, on_connect_failed() is invoked and the socket is closed.
+     *
+     * @param timeout give up if the connection is not established in time (zero means no timeout)
+     * @return false if connecting failed right away
+     */
+    bool connect_async(std::unique_ptr<network::Socket> &&socket, const network::Address &address,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /// Is a connection attempt started by connect_async() still pending?
+    bool is_connecting() const
+    {
+        return m_connecting;
+    }
+
     /// Callbacks
     virtual void on_network_message(network::message_in_t &msg) { (void)msg; }
     virtual void on_new_connection(std::unique_ptr<network::Socket> &&socket) { (void)socket; }
     virtual void on_disconnect() {}
 
+    /// The connection started by connect_async() is established
+    virtual void on_connected() {}
+
+    /// The connection started by connect_async() failed or timed out (on_disconnect() will not be invoked)
+    virtual void on_connect_failed() {}
+
+    /// All queued data has been handed to the kernel (only invoked if it could not be sent right away)
+    virtual void on_send_queue_drained() {}
+
     bool has_messages()
     {
         const std::unique_lock lock(m_mutex);
@@ -65,6 +95,15 @@ public:
 
     void close_socket() override;
 
+    /// Closes the socket if this is an acceptor
+    void on_drain() override;
+
+    /// Has all queued data been sent?
+    bool is_drained() override;
+
+    /// Closes the socket without sending queued data
+    void force_close() override;
+
     const network::Socket& socket() const
     {
         return *m_socket;
@@ -72,6 +111,8 @@ public:
 
     void re_register(bool first_time) override;
 
+    using EventListener::set_edge_triggered;
+
     const network::MessageSlicer& message_slicer() const
     {
         if(!m_socket)
@@ -95,7 +136,19 @@ protected:
     std::unique_ptr<network::Socket> release_socket();
 
 private:
-    void close_socket_internal(std::unique_lock<std::mutex> &lock);
+    friend class ConnectTimer;
+
+    void close_socket_internal(std::unique_lock<std::mutex> &lock, bool fast = false);
+
+    /// Checks on a pending connection attempt; returns false if the TCP connection is not established (yet)
+    bool update_connection_state();
+
+    /// Invokes on_connected() once
+    void connection_established();
+
+    void on_connect_timeout();
+
+    void stop_connect_timer();
 
     void set_mode(EventListener::Mode mode);
 
@@ -116,6 +169,15 @@ private:
     bool m_has_disconnected = false;
 
     EventListener::Mode m_mode = EventListener::Mode::ReadOnly;
+
+    /// Connections accepted by a SO_REUSEPORT acceptor stay on the acceptor's shard
+    bool m_local_accept = false;
+
+    std::atomic<bool> m_connecting = false;
+    std::chrono::milliseconds m_connect_timeout{0};
+
+    std::mutex m_connect_mutex;
+    std::shared_ptr<EventListener> m_connect_timer = nullptr;
 };
 
 inline void NetworkSocketListener::close_socket()
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace yael
+{
+
+/// Blocks up to this size are pooled; larger ones come straight from the heap
+constexpr size_t MAX_POOLED_SIZE = 16 * 1024;
+
+/// Free blocks each thread keeps per size class
+constexpr size_t MAX_POOLED_BLOCKS = 256;
+
+/**
+ * Allocate memory for a short-lived per-connection object
+ *
+ * Freed blocks go to a free list of the freeing thread (one per size class) and are handed out again by
+ * the next allocation of that size on the same thread. This avoids going through malloc for every
+ * connection when many connections are opened and closed.
+ */
+void* pool_allocate(size_t size);
+
+/// @param size has to be the same as passed to pool_allocate
+void pool_deallocate(void *ptr, size_t size) noexcept;
+
+/// An allocator (e.g., for std::allocate_shared) that uses pool_allocate
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &other) noexcept
+    {
+        (void)other;
+    }
+
+    T* allocate(size_t n)
+    {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        else
+        {
+            return static_cast<T*>(pool_allocate(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T *ptr, size_t n) noexcept
+    {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            ::operator delete(ptr, n * sizeof(T), std::align_val_t(alignof(T)));
+        }
+        else
+        {
+            pool_deallocate(ptr, n * sizeof(T));
+        }
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &other) const noexcept
+    {
+        (void)other;
+        return true;
+    }
+};
+
+/**
+ * Derive from this to allocate objects (and objects of derived classes) with pool_allocate
+ * The class must have a virtual destructor, so that the size of the derived class is known on deletion.
+ */
+class Pooled
+{
+public:
+    static void* operator new(size_t size)
+    {
+        return pool_allocate(size);
+    }
+
+    static void operator delete(void *ptr, size_t size) noexcept
+    {
+        pool_deallocate(ptr, size);
+    }
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <initializer_list>
+#include <mutex>
+
+#include "EventListener.h"
+
+namespace yael
+{
+
+/**
+ * @brief Delivers signals as ordinary events (using signalfd)
+ *
+ * The signals are blocked for the thread that creates the listener. Worker threads block them as well
+ * (see event_loop_config_t::block_signals), so create the listener on the main thread.
+ * Only signals that are sent to the process as a whole (e.g., by kill) are received.
+ */
+class SignalEventListener : public EventListener
+{
+public:
+    explicit SignalEventListener(std::initializer_list<int> signals);
+    ~SignalEventListener() override;
+
+    SignalEventListener(const SignalEventListener &other) = delete;
+
+    /// Invoked on a worker thread for every signal received
+    virtual void on_signal(int signo) = 0;
+
+    /// Stop listening for signals (they stay blocked)
+    void close_socket() override;
+
+    bool is_valid() final
+    {
+        const std::unique_lock lock(m_mutex);
+        return m_fd >= 0;
+    }
+
+    void re_register(bool first_time) override;
+
+private:
+    int32_t get_fileno() const final
+    {
+        return m_fileno;
+    }
+
+    void on_read_ready() final;
+    void on_write_ready() final {}
+    void on_error() final;
+
+    int32_t m_fileno;
+    int32_t m_fd;
+
+    std::mutex m_mutex;
+};
+
+}
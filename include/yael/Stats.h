@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace yael
+{
+
+/**
+ * @brief Log-linear histogram (similar to HdrHistogram)
+ *
+ * Every power of two is split into 2^SUB_BUCKET_BITS buckets, so values are recorded with a relative error of
+ * at most 1/2^SUB_BUCKET_BITS. Recording takes no lock but only one thread may record at a time.
+ * Other threads may read (or copy) the histogram concurrently.
+ */
+class Histogram
+{
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1U << SUB_BUCKET_BITS;
+    static constexpr uint32_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    Histogram() = default;
+    Histogram(const Histogram &other) noexcept;
+    Histogram& operator=(const Histogram &other) noexcept;
+
+    void record(uint64_t value) noexcept;
+
+    /// Add all values recorded by the other histogram
+    /// @note must not be called concurrently with record()
+    void merge(const Histogram &other) noexcept;
+
+    [[nodiscard]]
+    uint64_t count() const noexcept
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    uint64_t max() const noexcept
+    {
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    double mean() const noexcept;
+
+    /**
+     * Get (an upper bound of) the value at the specified percentile
+     * @param percentile in the range [0,100]
+     */
+    [[nodiscard]]
+    uint64_t percentile(double percentile) const noexcept;
+
+    static uint32_t get_bucket(uint64_t value) noexcept;
+
+    /// The highest value that falls into the specified bucket
+    static uint64_t get_bucket_upper_bound(uint32_t bucket) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_buckets = {};
+    std::atomic<uint64_t> m_count = 0;
+    std::atomic<uint64_t> m_sum = 0;
+    std::atomic<uint64_t> m_max = 0;
+};
+
+/// Statistics of a single worker thread (or of all of them)
+struct worker_stats_t
+{
+    /// How often the worker returned from waiting for events
+    uint64_t wakeups = 0;
+
+    /// Number of events dispatched to listeners
+    uint64_t events = 0;
+
+    /// Number of tasks run (see EventLoop::post)
+    uint64_t tasks = 0;
+
+    /// How often events arrived while the worker was busy polling (see event_loop_config_t::busy_poll_us)
+    uint64_t busy_poll_hits = 0;
+
+    /**
+     * Time spent in listener callbacks, per event (in nanoseconds)
+     * @note only recorded if event_loop_config_t::measure_latency is set
+     */
+    Histogram handler_time;
+
+    /**
+     * Time between the worker waking up and invoking the listener (in nanoseconds)
+     * This includes time spent handling other events of the same batch.
+     * @note only recorded if event_loop_config_t::measure_latency is set
+     */
+    Histogram queue_delay;
+
+    /// Add the statistics of another worker
+    void merge(const worker_stats_t &other) noexcept;
+};
+
+/// Snapshot of the statistics of an event loop
+struct event_loop_stats_t
+{
+    std::vector<worker_stats_t> workers;
+
+    /// Combined statistics of all workers
+    [[nodiscard]]
+    worker_stats_t total() const;
+};
+
+}
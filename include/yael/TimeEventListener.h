@@ -2,13 +2,21 @@
 
 #include <chrono>
 #include <mutex>
-#include <set>
+#include <vector>
 
 #include "EventListener.h"
 
 namespace yael
 {
 
+class TimerWheel;
+
+/**
+ * @brief Invokes on_time_event() after a delay
+ *
+ * Time event listeners do not have a file descriptor. They are driven by the timing wheel of the shard they are
+ * registered with, which uses a single timerfd for all of them.
+ */
 class TimeEventListener : public EventListener
 {
 public:
@@ -18,15 +26,35 @@ public:
     /// Trigger time event in [delay] ms from now
     bool schedule(uint64_t delay);
 
+    /**
+     * Trigger time event after the delay
+     * The precision is set by the event loop's timer_resolution (see event_loop_config_t).
+     * @note On worker threads, the delay is relative to when the worker woke up (see EventLoop::get_time).
+     */
+    bool schedule(std::chrono::nanoseconds delay);
+
+    /// Trigger time event at the specified point in time
+    bool schedule_at(std::chrono::steady_clock::time_point deadline);
+
     /// Remove all time events for this object
     bool unschedule();
 
     virtual void on_time_event() = 0;
 
-    /// Close the underlying socket
+    /// Stop the listener and unregister it
     void close_socket() override;
 
-    /// Get the current time (since unix epoch) in milliseconds
+    /**
+     * Have all events that are due before the event loop's drain deadline fired?
+     * When the event loop stops gracefully, pending events still fire if they are due before the deadline.
+     * Listeners whose next event is due later are closed right away.
+     */
+    bool is_drained() override;
+
+    /**
+     * Get the current time (since unix epoch) in milliseconds
+     * @note this reads the wall clock; scheduling is based on the event loop's cached time (see EventLoop::get_time)
+     */
     uint64_t get_current_time() const
     {
         auto current_time = std::chrono::system_clock::now().time_since_epoch();
@@ -36,28 +64,66 @@ public:
     bool is_valid() final
     {
         const std::unique_lock lock(m_mutex);
-        return m_fd >= 0;
+        return !m_closed;
     }
 
     void re_register(bool first_time) override;
 
 private:
-    bool internal_schedule(uint64_t delay);
+    friend class TimerWheel;
+
+    /// @param deadline in nanoseconds (see EventLoop::get_time_ns)
+    bool internal_schedule(uint64_t deadline);
+
+    /// Links the listener into its shard's timing wheel (only accessed by the wheel)
+    struct timer_node_t
+    {
+        timer_node_t *prev = nullptr;
+        timer_node_t *next = nullptr;
+
+        /// Slot of the wheel the timer is in (level is -1 if the timer is not set)
+        int32_t level = -1;
+        uint32_t slot = 0;
+
+        uint64_t expires = 0;
+
+        /// Set while the listener handles expired events
+        bool firing = false;
 
+        /// Keeps the listener alive while it is registered
+        std::shared_ptr<TimeEventListener> owner = nullptr;
+
+        /// All attached listeners of the wheel
+        timer_node_t *attached_prev = nullptr;
+        timer_node_t *attached_next = nullptr;
+    };
+
+    /// The timing wheel of the shard this listener is registered with (if any)
+    TimerWheel* get_timer_wheel() const;
+
+    /// The event loop's time in nanoseconds
+    uint64_t get_loop_time_ns() const;
+
+    /// Time event listeners are not backed by a file descriptor
     int32_t get_fileno() const final
     {
-        return m_fileno;
+        return -1;
     }
 
     void on_read_ready() final;
     void on_write_ready() final {}
     void on_error() final;
 
-    int32_t m_fileno;
-    int32_t m_fd;
-
     std::mutex m_mutex;
-    std::multiset<uint64_t> m_queued_events;
+    bool m_closed = false;
+
+    /// Set while on_time_event() is invoked for expired events
+    bool m_firing = false;
+
+    /// Min-heap of the deadlines (in nanoseconds) of all pending events; only the earliest one is in the timing wheel
+    std::vector<uint64_t> m_queued_events;
+
+    timer_node_t m_timer;
 };
 
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace yael::trace
+{
+
+/// Number of spans each thread keeps by default
+constexpr size_t DEFAULT_EVENTS_PER_THREAD = 64 * 1024;
+
+namespace detail
+{
+extern std::atomic<bool> enabled;
+
+uint64_t now() noexcept;
+
+void record(const char *name, int32_t fileno, uint64_t start, uint64_t end) noexcept;
+}
+
+/**
+ * Start recording spans
+ *
+ * Every thread records into its own ring buffer, which keeps the most recent events_per_thread spans.
+ * The size only applies to threads that have not recorded anything yet.
+ * Once a thread terminates, its ring is handed to the next new thread, which drops the spans of the terminated one.
+ */
+void enable(size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+/// Stop recording spans. Already recorded spans are kept.
+void disable() noexcept;
+
+inline bool is_enabled() noexcept
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Write all recorded spans in the Chrome trace event format
+ * The output can be viewed with chrome://tracing or Perfetto.
+ */
+void write_chrome_trace(std::ostream &out);
+
+/**
+ * @brief Records the time between its construction and destruction (if tracing is enabled)
+ * @note name must be a string literal (or otherwise outlive the trace)
+ */
+class Span
+{
+public:
+    explicit Span(const char *name, int32_t fileno = -1) noexcept
+        : m_name(name), m_fileno(fileno), m_start(is_enabled() ? detail::now() : 0)
+    {
+    }
+
+    Span(const Span &other) = delete;
+
+    ~Span()
+    {
+        if (m_start != 0)
+        {
+            detail::record(m_name, m_fileno, m_start, detail::now());
+        }
+    }
+
+private:
+    const char *m_name;
+    int32_t m_fileno;
+    uint64_t m_start;
+};
+
+}
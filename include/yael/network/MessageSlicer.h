@@ -2,6 +2,7 @@
 
 #include <memory>
 #include "buffer.h"
+#include "../Pool.h"
 
 namespace yael::network {
 
@@ -25,7 +26,7 @@ enum class MessageMode
     Stream
 };
 
-class MessageSlicer
+class MessageSlicer : public Pooled
 {
 public:
     virtual ~MessageSlicer() = default;
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Address.h"
+
+namespace yael
+{
+class EventLoop;
+}
+
+namespace yael::network
+{
+
+struct resolver_config_t
+{
+    /// Number of threads that invoke getaddrinfo
+    uint32_t num_threads = 2;
+
+    /**
+     * How long successful lookups are cached
+     * getaddrinfo does not expose the TTL of DNS records, so this is an upper bound set by the application.
+     */
+    std::chrono::milliseconds positive_ttl = std::chrono::seconds(60);
+
+    /// How long failed lookups (e.g., unknown hosts) are cached
+    std::chrono::milliseconds negative_ttl = std::chrono::seconds(5);
+};
+
+/**
+ * @brief Resolves host names without blocking the event loop
+ *
+ * Lookups run on a small pool of dedicated threads and their results are cached.
+ * Concurrent lookups of the same host are only resolved once.
+ */
+class Resolver
+{
+public:
+    /// Receives the address, or an empty optional if the host could not be resolved
+    using Callback = std::function<void(std::optional<Address>)>;
+
+    explicit Resolver(EventLoop &event_loop, const resolver_config_t &config = {});
+
+    Resolver(const Resolver &other) = delete;
+
+    /// Waits for running lookups to finish. Callbacks of pending lookups are not invoked.
+    ~Resolver();
+
+    /**
+     * Resolve the host name
+     * The callback always runs on one of the event loop's worker threads, even if the result was cached.
+     */
+    void resolve(const std::string &host, uint16_t port_number, bool IPv6, Callback callback);
+
+    /// Look up the cache only (never blocks)
+    std::optional<Address> lookup(const std::string &host, uint16_t port_number, bool IPv6 = false);
+
+    /// Forget all cached results
+    void clear_cache();
+
+private:
+    struct entry_t
+    {
+        std::optional<Address> address;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct waiter_t
+    {
+        uint16_t port_number;
+        Callback callback;
+    };
+
+    void thread_loop();
+
+    void complete(const std::string &key, const std::optional<Address> &address, bool cache);
+
+    void deliver(std::vector<waiter_t> &&waiters, const std::optional<Address> &address);
+
+    EventLoop &m_event_loop;
+    const resolver_config_t m_config;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stopped = false;
+
+    std::unordered_map<std::string, entry_t> m_cache;
+
+    /// Expired entries are removed once the cache grows beyond this
+    size_t m_prune_threshold;
+
+    /// Callbacks of lookups that are queued or running
+    std::unordered_map<std::string, std::vector<waiter_t>> m_pending;
+
+    std::deque<std::string> m_queue;
+    std::vector<std::thread> m_threads;
+};
+
+}
@@ -9,6 +9,7 @@
 
 #include "Address.h"
 #include "MessageSlicer.h"
+#include "../Pool.h"
 
 namespace yael::network {
 
@@ -56,7 +57,8 @@ private:
 class send_queue_full : public std::exception {};
 
 /// Abstract socket interface
-class Socket
+/// Sockets are pooled, because they are created (and destroyed) for every connection
+class Socket : public Pooled
 {
 public:
     static constexpr uint16_t ANY_PORT = 0;
@@ -77,6 +79,39 @@ public:
     //! Connect to an address
     virtual bool connect(const Address& address, const std::string& name = "") __attribute__((warn_unused_result)) = 0;
 
+    /**
+     * Start connecting to an address without blocking
+     *
+     * Call finish_connect() once the socket becomes writable (e.g., by registering it with the event loop in read-write mode).
+     * By default, this falls back to a blocking connect(), so sockets that do not support connecting asynchronously are
+     * connected once this returns.
+     *
+     * @return false if connecting failed right away
+     */
+    virtual bool connect_async(const Address& address, const std::string& name = "") __attribute__((warn_unused_result))
+    {
+        return connect(address, name);
+    }
+
+    /**
+     * Complete a connection that was started by connect_async()
+     * For TLS, this starts the handshake.
+     *
+     * @throws socket_error if connecting failed
+     * @return false if the TCP connection is still pending
+     */
+    virtual bool finish_connect()
+    {
+        return true;
+    }
+
+    /// Has connect_async() been called, but the connection (including the TLS session, if any) has not been established yet?
+    [[nodiscard]]
+    virtual bool is_connecting() const
+    {
+        return false;
+    }
+
     //! Wait for the connection to be established
     //! This is a no-op for plain TCP/UDP but will block for encrypted channels
     //! You need to call this after connect() and registering the socket with and event loop
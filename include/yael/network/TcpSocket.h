@@ -38,10 +38,43 @@ public:
 
     bool connect(const Address& address, const std::string& name = "") override __attribute__((warn_unused_result));
 
+    bool connect_async(const Address& address, const std::string& name = "") override __attribute__((warn_unused_result));
+
+    bool finish_connect() override;
+
+    [[nodiscard]]
+    bool is_connecting() const override;
+
     bool listen(const Address& address, uint32_t backlog) override __attribute__((warn_unused_result));
 
     using Socket::listen;
 
+    /**
+     * Allow other sockets to listen on the same address (SO_REUSEPORT)
+     *
+     * The kernel then balances incoming connections across all of them.
+     * Create one acceptor per shard of the event loop to spread accepting new connections over cores.
+     *
+     * @note must be called before listen()
+     */
+    void set_reuse_port(bool enabled);
+
+    /// Is SO_REUSEPORT set (or will it be set once the socket listens)?
+    [[nodiscard]]
+    bool reuse_port() const
+    {
+        return m_reuse_port;
+    }
+
+    /**
+     * Let the kernel busy poll the device queue when reading from this socket (SO_BUSY_POLL and SO_PREFER_BUSY_POLL)
+     *
+     * @param usecs how long to busy poll, 0 disables it
+     * @note requires a connected socket, and CAP_NET_ADMIN for values above net.core.busy_read
+     * @return false if the option could not be set
+     */
+    bool set_busy_poll(uint32_t usecs);
+
     /// Returns true if the socket closed right away
     /// False if there is still data to be written
     bool close(bool fast = false) override;
@@ -180,6 +213,12 @@ protected:
     //! Only used by connect() and listen()
     bool bind_socket(const Address& address);
 
+    //! Create the socket and invoke ::connect()
+    //! @return the result of ::connect()
+    int internal_connect(const Address& address, const std::string& name, bool blocking);
+
+    void set_blocking(bool blocking);
+
     MessageSlicer& get_slicer() {
         return *m_slicer;
     } 
@@ -192,6 +231,7 @@ private:
     //! Port used on our side of the connection
     uint16_t m_port;
     bool m_is_ipv6;
+    bool m_reuse_port = false;
 
     //! File descriptor
     std::atomic<int> m_fd;
@@ -206,6 +246,7 @@ private:
     enum class State
     {
         Listening,
+        Connecting,
         Connected,
         Shutdown,
         Closed,
@@ -236,6 +277,11 @@ inline bool TcpSocket::is_connected() const
     return m_state == State::Connected;
 }
 
+inline bool TcpSocket::is_connecting() const
+{
+    return m_state == State::Connecting;
+}
+
 inline bool TcpSocket::is_listening() const
 {
     return m_state == State::Listening;
@@ -25,6 +25,14 @@ public:
 
     bool connect(const Address& address, const std::string& name = "") override __attribute__((warn_unused_result));
 
+    /// Same as TcpSocket::connect_async. The handshake runs once the TCP connection is established
+    bool connect_async(const Address& address, const std::string& name = "") override __attribute__((warn_unused_result));
+
+    bool finish_connect() override;
+
+    [[nodiscard]]
+    bool is_connecting() const override;
+
     bool listen(const Address& address, uint32_t backlog) override __attribute__((warn_unused_result));
     using Socket::listen;
 
@@ -59,6 +67,7 @@ private:
     {
         Unknown,
         Listening,
+        Connecting,
         Setup,
         Connected,
         Shutdown,
@@ -0,0 +1,104 @@
+#include "Affinity.h"
+
+#include <glog/logging.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace yael {
+
+// Avoids depending on libnuma just for this (see linux/mempolicy.h)
+constexpr int MPOL_PREFERRED_MODE = 1;
+
+std::optional<std::vector<int32_t>> parse_cpu_list(const std::string &str) {
+    std::vector<int32_t> result;
+    std::stringstream stream(str);
+    std::string range;
+
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+
+        try {
+            size_t pos = 0;
+            const auto first = std::stoi(range, &pos);
+            auto last = first;
+
+            if (pos < range.size() && range[pos] == '-') {
+                last = std::stoi(range.substr(pos + 1));
+            }
+
+            if (first < 0 || last < first) {
+                return std::nullopt;
+            }
+
+            for (auto cpu = first; cpu <= last; ++cpu) {
+                result.push_back(cpu);
+            }
+        } catch (const std::exception &) {
+            return std::nullopt;
+        }
+    }
+
+    return result;
+}
+
+std::optional<std::vector<int32_t>> get_numa_node_cpus(int32_t node) {
+    const auto path =
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    std::ifstream file(path);
+    std::string content;
+
+    if (!file || !std::getline(file, content)) {
+        LOG(ERROR) << "Failed to read " << path;
+        return std::nullopt;
+    }
+
+    return parse_cpu_list(content);
+}
+
+bool pin_current_thread(int32_t cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+
+    const auto res =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+
+    if (res != 0) {
+        LOG(WARNING) << "Failed to pin thread to CPU " << cpu << ": "
+                     << strerror(res);
+        return false;
+    }
+
+    return true;
+}
+
+bool prefer_numa_node(int32_t node) {
+    constexpr size_t MASK_BITS = 8 * sizeof(unsigned long);
+
+    if (node < 0 || static_cast<size_t>(node) >= MASK_BITS) {
+        LOG(WARNING) << "Cannot set memory policy for NUMA node " << node;
+        return false;
+    }
+
+    const unsigned long nodemask = 1UL << node;
+
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, &nodemask,
+                MASK_BITS) != 0) {
+        LOG(WARNING) << "Failed to set memory policy for NUMA node " << node
+                     << ": " << strerror(errno);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace yael
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace yael {
+
+/**
+ * Parse a list of CPUs in the format used by the kernel, e.g. "0-3,8,10-11"
+ * @return std::nullopt if the list is malformed
+ */
+std::optional<std::vector<int32_t>> parse_cpu_list(const std::string &str);
+
+/// Get the CPUs that belong to the specified NUMA node (using sysfs)
+std::optional<std::vector<int32_t>> get_numa_node_cpus(int32_t node);
+
+/// Restrict the calling thread to the specified CPU
+bool pin_current_thread(int32_t cpu);
+
+/// Make the kernel allocate memory for the calling thread on this node, if possible
+bool prefer_numa_node(int32_t node);
+
+} // namespace yael
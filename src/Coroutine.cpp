@@ -0,0 +1,256 @@
+#include "yael/Coroutine.h"
+
+#include <atomic>
+#include <cstring>
+#include <exception>
+
+#include "yael/TimeEventListener.h"
+#include "yael/network/TcpSocket.h"
+
+namespace yael {
+
+void Task::promise_type::unhandled_exception() noexcept {
+    try {
+        std::rethrow_exception(std::current_exception());
+    } catch (const std::exception &e) {
+        LOG(ERROR) << "Coroutine failed: " << e.what();
+    } catch (...) {
+        LOG(ERROR) << "Coroutine failed with an unknown exception";
+    }
+}
+
+/// Fires once and resumes a coroutine
+class CoroutineTimer : public TimeEventListener {
+  public:
+    explicit CoroutineTimer(std::coroutine_handle<> handle)
+        : m_handle(handle) {}
+
+    void on_time_event() override {
+        if (!m_pending.exchange(false)) {
+            return;
+        }
+
+        // Release the timer before the coroutine continues
+        close_socket();
+        m_handle.resume();
+    }
+
+    void close_socket() override {
+        TimeEventListener::close_socket();
+
+        // Closed before it fired (e.g., because the event loop stopped).
+        // Nobody else will resume the coroutine, so free its state.
+        if (m_pending.exchange(false)) {
+            m_handle.destroy();
+        }
+    }
+
+  private:
+    std::coroutine_handle<> m_handle;
+
+    /// Set until the coroutine is either resumed or destroyed
+    std::atomic<bool> m_pending = true;
+};
+
+void SleepAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    auto timer = m_event_loop.make_event_listener<CoroutineTimer>(handle);
+
+    // The coroutine might be resumed (and this awaitable be gone) right away
+    timer->schedule(m_duration);
+}
+
+AsyncConnection::AsyncConnection(std::unique_ptr<network::Socket> &&socket)
+    : NetworkSocketListener(std::move(socket), SocketType::Connection) {}
+
+AsyncConnection::AsyncConnection() = default;
+
+AsyncConnection::~AsyncConnection() {
+    // Messages nobody received
+    for (auto &msg : m_messages) {
+        delete[] msg.data;
+    }
+}
+
+AsyncConnection::SendAwaitable AsyncConnection::send(const uint8_t *data,
+                                                     size_t length) {
+    auto copy = std::make_unique<uint8_t[]>(length);
+    memcpy(copy.get(), data, length);
+
+    return SendAwaitable(*this, std::move(copy), length);
+}
+
+void AsyncConnection::on_network_message(network::message_in_t &msg) {
+    std::unique_lock lock(m_coroutine_mutex);
+    m_messages.push_back(msg);
+
+    auto receiver = std::exchange(m_receiver, nullptr);
+    lock.unlock();
+
+    // Continue on this worker thread
+    if (receiver) {
+        receiver.resume();
+    }
+}
+
+void AsyncConnection::on_disconnect() {
+    std::unique_lock lock(m_coroutine_mutex);
+    m_disconnected = true;
+
+    auto receiver = std::exchange(m_receiver, nullptr);
+    auto sender = std::exchange(m_sender, nullptr);
+    lock.unlock();
+
+    if (receiver) {
+        receiver.resume();
+    }
+
+    if (sender) {
+        sender.resume();
+    }
+}
+
+void AsyncConnection::on_send_queue_drained() {
+    std::unique_lock lock(m_coroutine_mutex);
+    auto sender = std::exchange(m_sender, nullptr);
+    lock.unlock();
+
+    if (sender) {
+        sender.resume();
+    }
+}
+
+void AsyncConnection::on_connected() {
+    std::unique_lock lock(m_coroutine_mutex);
+    auto connector = std::exchange(m_connector, nullptr);
+    lock.unlock();
+
+    if (connector) {
+        connector.resume();
+    }
+}
+
+void AsyncConnection::on_connect_failed() {
+    std::unique_lock lock(m_coroutine_mutex);
+    m_connect_failed = true;
+
+    auto connector = std::exchange(m_connector, nullptr);
+    lock.unlock();
+
+    if (connector) {
+        connector.resume();
+    }
+}
+
+bool AsyncConnection::ReceiveAwaitable::await_suspend(
+    std::coroutine_handle<> handle) {
+    const std::unique_lock lock(m_connection.m_coroutine_mutex);
+
+    if (!m_connection.m_messages.empty() || m_connection.m_disconnected) {
+        return false;
+    }
+
+    m_connection.m_receiver = handle;
+    return true;
+}
+
+std::optional<network::message_in_t>
+AsyncConnection::ReceiveAwaitable::await_resume() {
+    const std::unique_lock lock(m_connection.m_coroutine_mutex);
+
+    if (m_connection.m_messages.empty()) {
+        return {};
+    }
+
+    auto msg = m_connection.m_messages.front();
+    m_connection.m_messages.pop_front();
+
+    return msg;
+}
+
+bool AsyncConnection::SendAwaitable::await_suspend(
+    std::coroutine_handle<> handle) {
+    // The awaitable lives in the coroutine frame, which might be resumed by
+    // another thread once the handle is stored
+    auto &connection = m_connection;
+
+    if (!connection.is_valid()) {
+        return false;
+    }
+
+    connection.NetworkSocketListener::send(std::move(m_data), m_length);
+
+    uint64_t send_id = 0;
+
+    {
+        const std::unique_lock lock(connection.m_coroutine_mutex);
+
+        if (connection.m_disconnected) {
+            return false;
+        }
+
+        connection.m_sender = handle;
+        send_id = ++connection.m_num_sends;
+    }
+
+    // Do not call is_drained() while holding the lock. The socket might be
+    // closed (and on_disconnect invoked) while the send mutex is held
+    if (!connection.is_drained()) {
+        return true;
+    }
+
+    // Everything was sent already. Resume right away, unless
+    // on_send_queue_drained() took care of it
+    const std::unique_lock lock(connection.m_coroutine_mutex);
+
+    // The coroutine might already be waiting for its next send
+    if (connection.m_sender && connection.m_num_sends == send_id) {
+        connection.m_sender = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool AsyncConnection::SendAwaitable::await_resume() {
+    std::unique_lock lock(m_connection.m_coroutine_mutex);
+    const bool disconnected = m_connection.m_disconnected;
+    lock.unlock();
+
+    return !disconnected && m_connection.is_valid();
+}
+
+bool ConnectAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    auto connection = std::make_shared<AsyncConnection>();
+
+    {
+        const std::unique_lock lock(connection->m_coroutine_mutex);
+        connection->m_connector = handle;
+    }
+
+    if (!connection->connect_async(std::make_unique<network::TcpSocket>(),
+                                   m_address, m_timeout)) {
+        return false;
+    }
+
+    m_connection = connection;
+
+    // The coroutine might be resumed (and this awaitable be gone) right away
+    m_event_loop.register_event_listener(std::move(connection));
+    return true;
+}
+
+std::shared_ptr<AsyncConnection> ConnectAwaitable::await_resume() {
+    if (!m_connection) {
+        return nullptr;
+    }
+
+    const std::unique_lock lock(m_connection->m_coroutine_mutex);
+
+    if (m_connection->m_connect_failed) {
+        return nullptr;
+    }
+
+    return m_connection;
+}
+
+} // namespace yael
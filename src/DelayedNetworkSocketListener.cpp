@@ -49,6 +49,11 @@ class DelayedMessageSender : public TimeEventListener {
         TimeEventListener::close_socket();
     }
 
+    bool is_drained() override {
+        const std::unique_lock lock(m_mutex);
+        return m_pending_messages.empty();
+    }
+
     void schedule(std::shared_ptr<uint8_t[]> &&data, size_t length,
                   uint32_t delay, bool blocking) {
         const std::unique_lock lock(m_mutex);
@@ -94,7 +99,7 @@ DelayedNetworkSocketListener::DelayedNetworkSocketListener(
     uint32_t delay, std::unique_ptr<network::Socket> &&socket, SocketType type)
     : m_delay(delay) {
     if (socket) {
-        DelayedNetworkSocketListener::set_socket(
+        NetworkSocketListener::set_socket(
             std::forward<std::unique_ptr<network::Socket>>(socket), type);
     }
 }
@@ -104,13 +109,61 @@ DelayedNetworkSocketListener::~DelayedNetworkSocketListener() {
 }
 
 void DelayedNetworkSocketListener::close_socket() {
-    if (EventLoop::is_initialized() && m_sender != nullptr) {
-        m_sender->close_socket();
+    std::unique_lock lock(m_sender_mutex);
+    auto sender = m_sender;
+    lock.unlock();
+
+    if (sender != nullptr) {
+        sender->close_socket();
     }
 
     NetworkSocketListener::close_socket();
 }
 
+bool DelayedNetworkSocketListener::is_drained() {
+    std::unique_lock lock(m_sender_mutex);
+    auto sender = m_sender;
+    lock.unlock();
+
+    if (sender != nullptr && !sender->is_drained()) {
+        return false;
+    }
+
+    return NetworkSocketListener::is_drained();
+}
+
+void DelayedNetworkSocketListener::force_close() {
+    std::unique_lock lock(m_sender_mutex);
+    auto sender = m_sender;
+    lock.unlock();
+
+    if (sender != nullptr) {
+        sender->force_close();
+    }
+
+    NetworkSocketListener::force_close();
+}
+
+std::shared_ptr<DelayedMessageSender>
+DelayedNetworkSocketListener::get_sender() {
+    const std::unique_lock lock(m_sender_mutex);
+
+    if (m_sender == nullptr) {
+        // Use the same event loop as the socket
+        auto *el = event_loop();
+
+        if (el == nullptr) {
+            LOG(WARNING) << "Discarded delayed message because socket is not "
+                            "registered with an event loop";
+            return nullptr;
+        }
+
+        m_sender = el->make_event_listener<DelayedMessageSender>(this);
+    }
+
+    return m_sender;
+}
+
 void DelayedNetworkSocketListener::send(std::shared_ptr<uint8_t[]> &&data,
                                         size_t length, bool blocking,
                                         bool async) {
@@ -121,7 +174,9 @@ void DelayedNetworkSocketListener::send(std::shared_ptr<uint8_t[]> &&data,
     }
 
     // this will always be async
-    m_sender->schedule(std::move(data), length, m_delay, blocking);
+    if (auto sender = get_sender()) {
+        sender->schedule(std::move(data), length, m_delay, blocking);
+    }
 }
 
 void DelayedNetworkSocketListener::send(std::unique_ptr<uint8_t[]> &&data,
@@ -134,7 +189,9 @@ void DelayedNetworkSocketListener::send(std::unique_ptr<uint8_t[]> &&data,
     }
 
     // this will always be async
-    m_sender->schedule(std::move(data), length, m_delay, blocking);
+    if (auto sender = get_sender()) {
+        sender->schedule(std::move(data), length, m_delay, blocking);
+    }
 }
 
 void DelayedNetworkSocketListener::send(const uint8_t *data, size_t length,
@@ -145,18 +202,13 @@ void DelayedNetworkSocketListener::send(const uint8_t *data, size_t length,
     }
 
     // this will always be async
-    m_sender->schedule(data, length, m_delay, blocking);
+    if (auto sender = get_sender()) {
+        sender->schedule(data, length, m_delay, blocking);
+    }
 }
 
 void DelayedNetworkSocketListener::set_delay(uint32_t delay) {
     m_delay = delay;
 }
 
-void DelayedNetworkSocketListener::set_socket(
-    std::unique_ptr<network::Socket> &&socket, SocketType type) {
-    auto &el = EventLoop::get_instance();
-    m_sender = el.make_event_listener<DelayedMessageSender>(this);
-    NetworkSocketListener::set_socket(std::move(socket), type);
-}
-
 } // namespace yael
@@ -0,0 +1,60 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "Poller.h"
+
+namespace yael {
+
+// this code assumes epoll is thread-safe
+// see http://lkml.iu.edu/hypermail/linux/kernel/0602.3/1661.html
+class EpollPoller : public Poller {
+  public:
+    EpollPoller() : m_epoll_fd(epoll_create1(0)) {
+        if (m_epoll_fd < 0) {
+            LOG(FATAL) << "epoll_create1() failed: " << strerror(errno);
+        }
+    }
+
+    ~EpollPoller() override { ::close(m_epoll_fd); }
+
+    bool add(int32_t fileno, uint32_t flags) override {
+        return control(EPOLL_CTL_ADD, fileno, flags);
+    }
+
+    bool modify(int32_t fileno, uint32_t flags) override {
+        return control(EPOLL_CTL_MOD, fileno, flags);
+    }
+
+    bool remove(int32_t fileno) override {
+        return epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fileno, nullptr) == 0;
+    }
+
+    int wait(epoll_event *events, int max_events, int timeout) override {
+        return epoll_wait(m_epoll_fd, events, max_events, timeout);
+    }
+
+    [[nodiscard]]
+    bool is_thread_safe() const override {
+        return true;
+    }
+
+  private:
+    bool control(int op, int32_t fileno, uint32_t flags) {
+        struct epoll_event ev;
+        ev.events = flags;
+        ev.data.fd = fileno;
+
+        return epoll_ctl(m_epoll_fd, op, fileno, &ev) == 0;
+    }
+
+    const int32_t m_epoll_fd;
+};
+
+std::unique_ptr<Poller> make_epoll_poller() {
+    return std::make_unique<EpollPoller>();
+}
+
+} // namespace yael
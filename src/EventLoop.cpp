@@ -1,30 +1,62 @@
 #include "yael/EventLoop.h"
 
 #include <glog/logging.h>
+#include <pthread.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
 #include <cassert>
 #include <chrono>
-
+#include <csignal>
+#include <ctime>
+#include <new>
+#include <utility>
+
+#include "Affinity.h"
+#include "ListenerTable.h"
+#include "Poller.h"
+#include "Signals.h"
+#include "TaskQueue.h"
+#include "TimerWheel.h"
+#include "WorkerStats.h"
 #include "yael/EventListener.h"
+#include "yael/TimeEventListener.h"
+#include "yael/Trace.h"
 
 namespace yael {
 
-/// A thread can handle at most one event
-constexpr int32_t MAX_EVENTS = 1;
-
 const uint32_t BASE_EPOLL_FLAGS = EPOLLERR | EPOLLRDHUP | EPOLLONESHOT;
 
-// this code assumes epoll is thread-safe
-// see http://lkml.iu.edu/hypermail/linux/kernel/0602.3/1661.html
+/// Edge-triggered listeners stay armed; see dispatch_edge_triggered()
+const uint32_t EDGE_TRIGGERED_EPOLL_FLAGS = EPOLLERR | EPOLLRDHUP | EPOLLET;
+
+/// Bits of EventListener::m_event_state
+constexpr uint32_t LISTENER_OWNED = 1U << 0U;
+constexpr uint32_t LISTENER_PENDING_READ = 1U << 1U;
+constexpr uint32_t LISTENER_PENDING_WRITE = 1U << 2U;
+constexpr uint32_t LISTENER_PENDING_ERROR = 1U << 3U;
+
+/// Size of the submission queue of each io_uring
+constexpr uint32_t URING_NUM_ENTRIES = 256;
+
+/// Number of posted tasks each shard can hold without allocating
+constexpr size_t TASK_QUEUE_SIZE = 1024;
+
+/// Tasks a worker runs before checking for events again
+constexpr size_t MAX_TASKS_PER_WAKEUP = 64;
+
+/// How often stop(deadline) checks whether listeners have drained
+constexpr auto DRAIN_POLL_INTERVAL = std::chrono::milliseconds(1);
+
+inline uint32_t get_flags(EventListener::Mode mode, bool edge_triggered) {
+    const auto base =
+        edge_triggered ? EDGE_TRIGGERED_EPOLL_FLAGS : BASE_EPOLL_FLAGS;
 
-inline uint32_t get_flags(EventListener::Mode mode) {
     if (mode == EventListener::Mode::ReadOnly) {
-        return EPOLLIN | BASE_EPOLL_FLAGS;
+        return EPOLLIN | base;
     } else {
-        return EPOLLIN | EPOLLOUT | BASE_EPOLL_FLAGS;
+        return EPOLLIN | EPOLLOUT | base;
     }
 }
 
@@ -47,29 +79,161 @@ inline void decrement_semaphore(int32_t fd) {
     }
 }
 
-EventLoop::EventLoop(int32_t num_threads)
-    : m_okay(true), m_epoll_fd(epoll_create1(0)),
-      m_event_semaphore(eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE)),
-      m_num_threads(num_threads) {
-    if (m_epoll_fd < 0) {
-        LOG(FATAL) << "epoll_create1() failed: " << strerror(errno);
+EventLoop::shard_t::shard_t(size_t num_threads,
+                            std::unique_ptr<Poller> &&poller_,
+                            std::chrono::nanoseconds timer_resolution)
+    : poller(std::move(poller_)),
+      event_semaphore(eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE)),
+      tasks(std::make_unique<TaskQueue>(TASK_QUEUE_SIZE)),
+      event_listeners(std::make_unique<ListenerTable>(num_threads)),
+      timers(std::make_unique<TimerWheel>(timer_resolution)) {
+    if (num_threads > 1 && !poller->is_thread_safe()) {
+        LOG(FATAL) << "Poller can only be used by a single thread";
+    }
+}
+
+EventLoop::shard_t::~shard_t() { ::close(event_semaphore); }
+
+std::vector<EventListenerPtr> EventLoop::shard_t::snapshot() const {
+    auto result = event_listeners->snapshot();
+    auto time_listeners = timers->snapshot();
+
+    result.insert(result.end(), time_listeners.begin(), time_listeners.end());
+    return result;
+}
+
+size_t EventLoop::shard_t::num_listeners() const {
+    return event_listeners->size() + timers->size();
+}
+
+EventLoop::EventLoop(const event_loop_config_t &config)
+    : m_okay(true), m_shutdown_fd(eventfd(0, EFD_NONBLOCK)), m_config(config),
+      m_num_threads(config.num_threads), m_backend(config.backend) {
+    if (m_config.max_events <= 0) {
+        LOG(FATAL) << "Need to harvest at least one event per wakeup";
+    }
+
+    if (!m_config.cpus.empty()) {
+        m_cpus = m_config.cpus;
+    } else if (m_config.numa_node >= 0) {
+        if (auto cpus = get_numa_node_cpus(m_config.numa_node)) {
+            m_cpus = std::move(*cpus);
+        } else {
+            LOG(ERROR) << "Failed to get CPUs of NUMA node "
+                       << m_config.numa_node << ". Will not pin workers.";
+        }
+    }
+
+    if (m_num_threads <= 0 && !m_cpus.empty()) {
+        m_num_threads = static_cast<int32_t>(m_cpus.size());
+    }
+
+    if (m_num_threads <= 0) {
+        m_num_threads =
+            2 * static_cast<int32_t>(std::thread::hardware_concurrency());
+
+        if (m_num_threads <= 0) {
+            LOG(FATAL)
+                << "Could not detect number of hardware threads supported!";
+        }
+    }
+
+    if (m_backend == EventBackend::IoUring && !m_config.sharded) {
+        LOG(INFO) << "io_uring backend requires sharded mode. Enabling it.";
+        m_config.sharded = true;
+    }
+
+    if (m_config.min_threads > 0) {
+        if (m_config.sharded) {
+            LOG(WARNING) << "Elastic mode is not supported in sharded mode. "
+                            "Starting all workers.";
+        } else if (m_config.min_threads < m_num_threads) {
+            m_elastic = true;
+        }
+    }
+
+    const int32_t num_shards = m_config.sharded ? m_num_threads : 1;
+    const int32_t threads_per_shard = m_config.sharded ? 1 : m_num_threads;
+
+    for (int32_t i = 0; i < num_shards; ++i) {
+        std::unique_ptr<Poller> poller = nullptr;
+
+        if (m_backend == EventBackend::IoUring) {
+            poller = make_uring_poller(URING_NUM_ENTRIES);
+
+            if (poller == nullptr) {
+                // Can only happen for the first shard
+                LOG(WARNING) << "io_uring is not supported by the kernel. "
+                                "Falling back to epoll.";
+                m_backend = EventBackend::Epoll;
+            }
+        }
+
+        if (poller == nullptr) {
+            poller = make_epoll_poller();
+        }
+
+        auto &shard = m_shards.emplace_back(
+            std::make_unique<shard_t>(threads_per_shard, std::move(poller),
+                                      m_config.timer_resolution));
+
+        // TODO add a special semaphore event listener
+        register_socket(*shard, shard->event_semaphore, EPOLLIN | EPOLLET,
+                        false);
+
+        // Level-triggered and never consumed; wakes up all workers
+        register_socket(*shard, m_shutdown_fd, EPOLLIN, false);
+
+        register_socket(*shard, shard->timers->get_fileno(), EPOLLIN | EPOLLET,
+                        false);
+    }
+
+    for (int32_t i = 0; i < m_num_threads; ++i) {
+        m_worker_stats.emplace_back(std::make_unique<WorkerStats>());
+    }
+
+    m_threads.resize(m_num_threads);
+    m_worker_active.resize(m_num_threads, false);
+}
+
+EventLoop::~EventLoop() {
+    if (m_okay) {
+        stop();
     }
 
-    // TODO add a special semaphore event listener
-    register_socket(m_event_semaphore, EPOLLIN | EPOLLET, false);
+    wait();
+
+    ::close(m_shutdown_fd);
 }
 
-EventLoop::~EventLoop() { ::close(m_epoll_fd); }
+std::unique_ptr<EventLoop> EventLoop::create(const event_loop_config_t &config) {
+    std::unique_ptr<EventLoop> event_loop(new EventLoop(config));
+    event_loop->run();
+
+    return event_loop;
+}
 
 EventLoop *EventLoop::m_instance = nullptr;
+thread_local EventLoop *EventLoop::m_current_loop = nullptr;
+thread_local EventLoop::shard_t *EventLoop::m_current_shard = nullptr;
+thread_local bool EventLoop::m_keep_local = false;
+thread_local uint64_t EventLoop::m_loop_time = 0;
+
+void EventLoop::initialize(int32_t num_threads, int32_t max_events) noexcept {
+    event_loop_config_t config;
+    config.num_threads = num_threads;
+    config.max_events = max_events;
 
-void EventLoop::initialize(int32_t num_threads) noexcept {
+    initialize(config);
+}
+
+void EventLoop::initialize(const event_loop_config_t &config) noexcept {
     if (m_instance != nullptr) {
         VLOG(1) << "Event loop already initialized. Will not do anything.";
         return;
     }
 
-    m_instance = new EventLoop(num_threads);
+    m_instance = new EventLoop(config);
     m_instance->run();
 }
 
@@ -82,8 +246,12 @@ void EventLoop::destroy() noexcept {
         LOG(FATAL) << "Cannot stop event loop: has to be stopped first!";
     }
 
-    delete m_instance;
+    // Retired listeners might be released during destruction and must not
+    // try to unregister themselves
+    auto *instance = m_instance;
     m_instance = nullptr;
+
+    delete instance;
 }
 
 void EventLoop::stop() noexcept {
@@ -96,258 +264,881 @@ void EventLoop::stop() noexcept {
 
     LOG(INFO) << "Shutting down event loop";
 
-    std::unique_lock lock(m_event_listeners_mutex);
     m_okay = false;
+    shut_down();
+}
+
+void EventLoop::stop(std::chrono::milliseconds timeout) noexcept {
+    stop(std::chrono::steady_clock::now() + timeout);
+}
+
+void EventLoop::stop(std::chrono::steady_clock::time_point deadline) noexcept {
+    if (!m_okay || m_draining.exchange(true)) {
+        VLOG(1)
+            << "Already shutting down (or shut down). Will not stop event loop "
+               "again.";
+        return;
+    }
 
-    while (!m_event_listeners.empty()) {
-        auto it = m_event_listeners.begin();
-        auto listener = it->second;
+    LOG(INFO) << "Draining event loop";
 
-        VLOG(2) << "Stopping next event listener (fileno="
-                << listener->get_fileno() << ")";
+    // The event loop's clock has the same epoch as the steady clock
+    m_drain_deadline = static_cast<uint64_t>(std::max<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch())
+            .count(),
+        0));
 
-        lock.unlock();
-        listener->close_socket();
-        lock.lock();
+    for (auto &shard : m_shards) {
+        for (auto &listener : shard->snapshot()) {
+            listener->on_drain();
+        }
     }
 
-    while (!m_event_listeners.empty()) {
-        m_event_listeners_cond.wait(lock);
+    // Workers keep handling events (and sending queued data) meanwhile
+    while (std::chrono::steady_clock::now() < deadline) {
+        size_t num_remaining = 0;
+
+        for (auto &shard : m_shards) {
+            for (auto &listener : shard->snapshot()) {
+                if (listener->is_drained()) {
+                    VLOG(2) << "Closing drained event listener (fileno="
+                            << listener->get_fileno() << ")";
+                    listener->close_socket();
+                }
+            }
+
+            num_remaining += shard->num_listeners();
+        }
+
+        if (num_remaining == 0) {
+            break;
+        }
+
+        std::this_thread::sleep_for(DRAIN_POLL_INTERVAL);
     }
 
-    increment_semaphore(m_event_semaphore);
+    m_okay = false;
+    shut_down();
 }
 
-uint64_t EventLoop::get_time() const {
-    using std::chrono::steady_clock;
+void EventLoop::shut_down() noexcept {
+    for (auto &shard : m_shards) {
+        auto &listeners = *shard->event_listeners;
+
+        while (shard->num_listeners() > 0) {
+            for (auto &listener : shard->snapshot()) {
+                VLOG(2) << "Stopping next event listener (fileno="
+                        << listener->get_fileno() << ")";
+
+                if (m_draining) {
+                    listener->force_close();
+                } else {
+                    listener->close_socket();
+                }
+            }
+        }
 
-    auto res = steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-               res.time_since_epoch())
-        .count();
+        listeners.wait_empty();
+    }
+
+    // Wakes up every worker at once instead of one after another
+    increment_semaphore(m_shutdown_fd);
 }
 
-std::pair<EventListenerPtr, EventLoop::EventType> EventLoop::update() {
-    epoll_event events[MAX_EVENTS];
-    int nfds = -1;
-    const int32_t timeout = -1;
+bool EventLoop::post(std::function<void()> func) {
+    return post(Closure(std::move(func)));
+}
+
+bool EventLoop::post(Closure &&task) noexcept {
+    if (!m_okay) {
+        return false;
+    }
+
+    shard_t *shard = nullptr;
 
-    while (m_okay && nfds < 0) {
-        nfds = epoll_wait(m_epoll_fd, events, MAX_EVENTS, timeout);
+    if (m_current_loop == this) {
+        shard = m_current_shard;
+    } else {
+        shard = m_shards[m_next_task_shard++ % m_shards.size()].get();
     }
 
-    if (!m_okay && nfds <= 0) {
-        // Event loop was terminated; wakeup next thread
-        increment_semaphore(m_event_semaphore);
-        return {nullptr, EventType::None};
+    // Only spilling over into the overflow list allocates
+    try {
+        shard->tasks->push(std::move(task));
+    } catch (const std::bad_alloc &) {
+        LOG(ERROR) << "Failed to post task: out of memory";
+        return false;
     }
 
-    if (nfds < 0) {
-        // was interrupted by a signal. ignore
-        // badf means the content server is shutting down
-        if (errno == EINTR || errno == EBADF) {
-            stop();
-            return {nullptr, EventType::None};
+    increment_semaphore(shard->event_semaphore);
+    return true;
+}
+
+bool EventLoop::run_tasks(shard_t &shard, WorkerStats &stats) {
+    Closure task;
+
+    for (size_t count = 0; count < MAX_TASKS_PER_WAKEUP; ++count) {
+        if (!shard.tasks->pop(task)) {
+            return count > 0;
+        }
+
+        {
+            const trace::Span span("task");
+            task();
         }
 
-        // Let's try to continue here, if possible
-        LOG(ERROR) << "epoll_wait() returned an error: " << strerror(errno)
-                   << " (errno=" << errno << ")";
-        return {nullptr, EventType::None};
+        task.reset();
+
+        stats.add_task();
     }
 
-    if (nfds > 1) {
-        LOG(FATAL) << "Invalid state: got more than one event";
+    // There might be more; make sure some worker picks them up later
+    increment_semaphore(shard.event_semaphore);
+    return true;
+}
+
+event_loop_stats_t EventLoop::stats() const {
+    event_loop_stats_t result;
+    result.workers.reserve(m_worker_stats.size());
+
+    for (auto &worker : m_worker_stats) {
+        result.workers.push_back(worker->snapshot());
     }
 
-    auto fd = events[0].data.fd;
+    return result;
+}
 
-    if (fd == m_event_semaphore) {
-        // Consume it so the event fd doesn't overflow
-        decrement_semaphore(m_event_semaphore);
+uint64_t EventLoop::get_time() const { return get_time_ns() / 1'000'000; }
 
-        if (m_okay) {
-            DLOG(WARNING) << "Spurious wakeup";
-            return update();
-        } else {
-            // Event loop was terminated; wake up next thread
-            increment_semaphore(m_event_semaphore);
-            return {nullptr, EventType::None};
-        }
+uint64_t EventLoop::get_time_ns() const {
+    if (m_current_loop == this && m_loop_time != 0) {
+        return m_loop_time;
+    }
+
+    return read_clock();
+}
+
+uint64_t EventLoop::update_time() {
+    const auto now = read_clock();
+
+    if (m_current_loop == this) {
+        m_loop_time = now;
+    }
+
+    return now;
+}
+
+uint64_t EventLoop::read_clock() const {
+    const clockid_t clock_id =
+        m_config.clock_source == ClockSource::MonotonicCoarse
+            ? CLOCK_MONOTONIC_COARSE
+            : CLOCK_MONOTONIC;
+
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 +
+           static_cast<uint64_t>(ts.tv_nsec);
+}
+
+EventLoop::EventType EventLoop::get_event_type(uint32_t flags) {
+    // A hangup is reported as readable, so the listener gets to see EOF
+    // (e.g., when the other end of a pipe was closed)
+    const bool has_read = (flags & (EPOLLIN | EPOLLHUP)) != 0U;
+    const bool has_write = (flags & EPOLLOUT) != 0U;
+    const bool has_error = (flags & EPOLLERR) != 0U;
+
+    if (has_read && has_write) {
+        return EventType::ReadWrite;
+    } else if (has_read) {
+        return EventType::Read;
+    } else if (has_write) {
+        return EventType::Write;
+    } else if (has_error) {
+        return EventType::Error;
     } else {
-        EventType type;
-        auto flags = events[0].events;
+        LOG(FATAL) << "Invalid event flag";
+        return EventType::None;
+    }
+}
 
-        const bool has_read = (flags & EPOLLIN) != 0U;
-        const bool has_write = (flags & EPOLLOUT) != 0U;
-        const bool has_error = (flags & EPOLLERR) != 0U;
+bool EventLoop::update(shard_t &shard, size_t reader, epoll_event *raw_events,
+                       std::vector<event_t> &events,
+                       std::vector<EventListenerPtr> &expired,
+                       WorkerStats &stats, bool block, int32_t timeout) {
+    while (true) {
+        int nfds = -1;
 
-        if (has_read && has_write) {
-            type = EventType::ReadWrite;
-        } else if (has_read) {
-            type = EventType::Read;
-        } else if (has_write) {
-            type = EventType::Write;
-        } else if (has_error) {
-            type = EventType::Error;
+        if (!block) {
+            nfds = shard.poller->wait(raw_events, m_config.max_events, 0);
+
+            if (nfds <= 0) {
+                // Nothing new; the caller has other work to do
+                m_loop_time = read_clock();
+                return m_okay;
+            }
         } else {
-            LOG(FATAL) << "Invalid event flag";
+            if (m_elastic) {
+                m_num_idle += 1;
+
+                // Somebody is idle now, so there is no need for another worker
+                m_spawning = false;
+            }
+
+            if (m_config.busy_poll_us > 0) {
+                const trace::Span span("busy_poll");
+                nfds = busy_poll(shard, raw_events);
+
+                if (nfds > 0) {
+                    stats.add_busy_poll_hit();
+                }
+            }
+
+            while (m_okay && nfds <= 0) {
+                const trace::Span span("wait");
+                nfds = shard.poller->wait(raw_events, m_config.max_events,
+                                          timeout);
+
+                if (nfds == 0) {
+                    break;
+                }
+            }
+
+            if (m_elastic && (m_num_idle -= 1) == 0 && nfds > 0) {
+                // Nobody is left to pick up the next event
+                spawn_worker();
+            }
         }
 
-        const std::shared_lock lock(m_event_listeners_mutex);
-        auto it = m_event_listeners.find(fd);
+        // The only clock read per wakeup (unless measure_latency is set)
+        m_loop_time = read_clock();
 
-        if (it == m_event_listeners.end()) {
-            LOG(WARNING) << "Got event for unknown event listener with fileno="
-                         << fd;
-            return {nullptr, type};
-        } else {
-            return {it->second, type};
+        if (!m_okay && nfds <= 0) {
+            return false;
+        }
+
+        if (nfds == 0) {
+            // Timed out
+            return true;
+        }
+
+        if (nfds < 0) {
+            // was interrupted by a signal. ignore
+            // badf means the content server is shutting down
+            if (errno == EINTR || errno == EBADF) {
+                stop();
+                return false;
+            }
+
+            // Let's try to continue here, if possible
+            LOG(ERROR) << "Waiting for events failed: " << strerror(errno)
+                       << " (errno=" << errno << ")";
+            return false;
+        }
+
+        if (nfds > m_config.max_events) {
+            LOG(FATAL) << "Invalid state: got more events than requested";
+        }
+
+        bool terminate = false;
+        bool woken = false;
+
+        // Lookups take no lock. Entering the epoch keeps listeners that are
+        // unregistered concurrently alive until the caller handled the events
+        auto &listeners = *shard.event_listeners;
+        listeners.enter(reader);
+
+        for (int idx = 0; idx < nfds; ++idx) {
+            auto fd = raw_events[idx].data.fd;
+
+            if (fd == m_shutdown_fd) {
+                terminate = true;
+                continue;
+            }
+
+            if (fd == shard.event_semaphore) {
+                // Consume it so the event fd doesn't overflow
+                decrement_semaphore(shard.event_semaphore);
+
+                // There are posted tasks
+                woken = true;
+                continue;
+            }
+
+            if (fd == shard.timers->get_fileno()) {
+                const auto first = expired.size();
+                shard.timers->expire(get_time_ns(), expired);
+
+                for (auto idx = first; idx < expired.size(); ++idx) {
+                    events.emplace_back(expired[idx].get(), EventType::Read);
+                }
+
+                continue;
+            }
+
+            auto type = get_event_type(raw_events[idx].events);
+            auto *listener = listeners.lookup(fd);
+
+            if (listener == nullptr) {
+                LOG(WARNING)
+                    << "Got event for unknown event listener with fileno="
+                    << fd;
+            } else {
+                events.emplace_back(listener, type);
+            }
+        }
+
+        if (events.empty()) {
+            listeners.exit(reader);
+        }
+
+        if (terminate) {
+            return false;
+        }
+
+        if (!events.empty() || woken || !block) {
+            return true;
+        }
+    }
+}
+
+int EventLoop::busy_poll(shard_t &shard, epoll_event *raw_events) {
+    using std::chrono::steady_clock;
+
+    const auto deadline =
+        steady_clock::now() + std::chrono::microseconds(m_config.busy_poll_us);
+    int nfds = 0;
+
+    do {
+        nfds = shard.poller->wait(raw_events, m_config.max_events, 0);
+    } while (nfds == 0 && m_okay && steady_clock::now() < deadline);
+
+    return nfds;
+}
+
+int32_t EventLoop::select_shard(int32_t fileno, int32_t preferred) {
+    const auto num_shards = m_shards.size();
+
+    if (num_shards == 1) {
+        return 0;
+    }
+
+    // A previous listener with the same fileno might still be shutting down.
+    // The new one has to go to the same shard so we can wait for it below.
+    for (size_t idx = 0; idx < num_shards; ++idx) {
+        if (m_shards[idx]->event_listeners->contains(fileno)) {
+            return static_cast<int32_t>(idx);
+        }
+    }
+
+    // Timers set up by a handler (and listeners registered inside a
+    // LocalShardScope) stay on the handler's shard
+    if ((fileno < 0 || m_keep_local) && preferred < 0 &&
+        m_current_loop == this) {
+        for (size_t idx = 0; idx < num_shards; ++idx) {
+            if (m_shards[idx].get() == m_current_shard) {
+                return static_cast<int32_t>(idx);
+            }
+        }
+    }
+
+    if (preferred >= 0) {
+        return preferred;
+    }
+
+    if (m_config.shard_policy == ShardPolicy::LeastLoaded) {
+        size_t best = 0;
+
+        for (size_t idx = 1; idx < num_shards; ++idx) {
+            if (m_shards[idx]->event_listeners->size() <
+                m_shards[best]->event_listeners->size()) {
+                best = idx;
+            }
         }
+
+        return static_cast<int32_t>(best);
+    } else {
+        return static_cast<int32_t>(m_next_shard++ % num_shards);
     }
 }
 
 void EventLoop::register_event_listener(EventListenerPtr listener) noexcept {
-    std::unique_lock lock(m_event_listeners_mutex);
+    const auto shard_idx = select_shard(listener->get_fileno());
+    add_event_listener(std::move(listener), shard_idx);
+}
+
+void EventLoop::register_event_listener(EventListenerPtr listener,
+                                        size_t shard) noexcept {
+    const auto preferred = static_cast<int32_t>(shard % m_shards.size());
+    const auto shard_idx = select_shard(listener->get_fileno(), preferred);
+    add_event_listener(std::move(listener), shard_idx);
+}
+
+void EventLoop::add_event_listener(EventListenerPtr listener,
+                                   int32_t shard_idx) {
     auto idx = listener->get_fileno();
+    auto &shard = *m_shards[shard_idx];
 
-    while (true) {
-        auto res = m_event_listeners.emplace(idx, listener);
+    if (idx < 0) {
+        // Listeners without a file descriptor are driven by the timing wheel
+        auto timer = std::dynamic_pointer_cast<TimeEventListener>(listener);
 
-        if (res.second) {
-            break;
-        } else {
-            // wait for other thread to process old event listener disconnect
-            m_event_listeners_cond.wait(lock);
+        if (timer == nullptr) {
+            LOG(FATAL) << "Cannot register listener: invalid fileno " << idx;
         }
+
+        listener->m_shard = shard_idx;
+        listener->m_event_loop = this;
+        shard.timers->attach(std::move(timer));
+
+        listener->re_register(true);
+        return;
     }
 
-    lock.unlock();
+    // This will wait for other threads to process an old event listener
+    // disconnect with the same fileno (if any)
+    shard.event_listeners->insert(idx, listener);
+    listener->m_shard = shard_idx;
+    listener->m_event_loop = this;
 
     listener->re_register(true);
 }
 
-void EventLoop::register_socket(int32_t fileno, uint32_t flags, bool modify) {
-    VLOG(2) << "Registering new socket with fd=" << fileno;
+TimerWheel &EventLoop::get_timer_wheel(const EventListener &listener) {
+    return *m_shards[listener.m_shard]->timers;
+}
 
-    struct epoll_event ev;
-    ev.events = flags;
-    ev.data.fd = fileno;
+void EventLoop::register_socket(shard_t &shard, int32_t fileno, uint32_t flags,
+                                bool modify) {
+    VLOG(2) << "Registering new socket with fd=" << fileno;
 
-    auto op = modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    const bool success = modify ? shard.poller->modify(fileno, flags)
+                                : shard.poller->add(fileno, flags);
 
-    const int epoll_res = epoll_ctl(m_epoll_fd, op, fileno, &ev);
-    if (epoll_res != 0) {
-        LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno)
+    if (!success) {
+        LOG(ERROR) << "Registering socket failed: " << strerror(errno)
                    << " (fileno=" << fileno << ", modify=" << modify << ")";
     }
 }
 
-void EventLoop::notify_listener_mode_change(EventListenerPtr listener,
+void EventLoop::notify_listener_mode_change(EventListener &listener,
                                             EventListener::Mode mode,
                                             bool first_time) noexcept {
-    VLOG(3) << "Event listener (fileno=" << listener->get_fileno()
-            << ") mode changed to " << EventListener::mode_to_string(mode);
+    const auto fileno = listener.get_fileno();
 
-    auto flags = get_flags(mode);
+    VLOG(3) << "Event listener (fileno=" << fileno << ") mode changed to "
+            << EventListener::mode_to_string(mode);
 
-    {
-        const std::unique_lock lock(m_event_listeners_mutex);
-        auto it = m_event_listeners.find(listener->get_fileno());
+    auto flags = get_flags(mode, listener.is_edge_triggered());
+    const int32_t shard_idx = listener.m_shard;
 
-        if (it == m_event_listeners.end()) {
-            // can happen during shut down
-            LOG(WARNING) << "Failed to update mode for listener (fileno="
-                         << listener->get_fileno()
-                         << "): no such event listener";
-            return;
-        }
+    if (shard_idx < 0) {
+        LOG(WARNING) << "Failed to update mode for listener (fileno="
+                     << fileno << "): not registered";
+        return;
+    }
+
+    auto &shard = *m_shards[shard_idx];
+
+    // The pointer is only compared, so no epoch is needed
+    if (shard.event_listeners->lookup(fileno) != &listener) {
+        // can happen during shut down
+        LOG(WARNING) << "Failed to update mode for listener (fileno="
+                     << fileno << "): no such event listener";
+        return;
     }
 
-    register_socket(listener->get_fileno(), flags, !first_time);
+    register_socket(shard, fileno, flags, !first_time);
 }
 
 void EventLoop::unregister_event_listener(EventListenerPtr listener) noexcept {
     VLOG(2) << "Removing event listener (fileno=" << listener->get_fileno()
             << ")";
 
-    const std::unique_lock lock(m_event_listeners_mutex);
+    const int32_t shard_idx = listener->m_shard;
 
+    if (shard_idx < 0) {
+        LOG(WARNING) << "Could not unregister event listener. Did not exist?";
+        return;
+    }
+
+    auto &shard = *m_shards[shard_idx];
     auto fileno = listener->get_fileno();
-    auto it = m_event_listeners.find(fileno);
 
-    if (it == m_event_listeners.end()) {
-        LOG(WARNING) << "Could not unregister event listener. Did not exist?";
-    } else {
+    if (fileno < 0) {
+        auto &timer = static_cast<TimeEventListener &>(*listener);
+
+        if (shard.timers->detach(timer) != nullptr) {
+            listener->m_event_loop = nullptr;
+        } else {
+            LOG(WARNING)
+                << "Could not unregister event listener. Did not exist?";
+        }
+
+        return;
+    }
+
+    // Remove from the poller before a new listener can take over the fileno
+    auto remove_socket = [&shard, fileno]() {
         // (except for when releasing the socket manually)
-        const auto epoll_res =
-            epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fileno, nullptr);
-        if (epoll_res != 0) {
-            LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno)
+        if (!shard.poller->remove(fileno)) {
+            LOG(ERROR) << "Unregistering socket failed: " << strerror(errno)
                        << " (fileno=" << fileno << ")";
         }
+    };
+
+    if (shard.event_listeners->erase(fileno, remove_socket)) {
+        listener->m_event_loop = nullptr;
+    } else {
+        LOG(WARNING) << "Could not unregister event listener. Did not exist?";
+    }
+}
 
-        m_event_listeners.erase(it);
-        m_event_listeners_cond.notify_all();
+int32_t EventLoop::get_worker_cpu(size_t worker) const {
+    if (m_cpus.empty()) {
+        return -1;
     }
+
+    return m_cpus[worker % m_cpus.size()];
 }
 
-void EventLoop::thread_loop() {
-    while (this->is_okay()) {
-        auto res = update();
-        auto &[listener, type] = res;
+void EventLoop::thread_loop(shard_t &shard, size_t reader, size_t worker) {
+    const auto cpu = get_worker_cpu(worker);
+
+    if (cpu >= 0) {
+        pin_current_thread(cpu);
+    }
+
+    // Memory allocated by this worker (e.g. listeners created in callbacks
+    // and receive buffers) should live on the same node
+    if (m_config.cpus.empty() && m_config.numa_node >= 0) {
+        prefer_numa_node(m_config.numa_node);
+    }
+
+    std::vector<epoll_event> raw_events(m_config.max_events);
+    std::vector<event_t> events;
+    events.reserve(m_config.max_events);
+
+    auto &stats = *m_worker_stats[worker];
+    const bool measure = m_config.measure_latency;
+
+    // Listeners that deferred reading (see EventListener::defer_read) are
+    // resumed after the next batch of events
+    std::vector<EventListenerPtr> deferred;
+    std::vector<EventListenerPtr> resumed;
+
+    // Time event listeners of the current batch
+    std::vector<EventListenerPtr> expired;
+
+    m_current_loop = this;
+    m_current_shard = &shard;
+
+    uint64_t wakeup_time = 0;
+
+    // Elastic mode: workers check every idle_timeout whether they can retire
+    const auto idle_timeout = m_config.idle_timeout;
+    const int32_t timeout =
+        m_elastic ? static_cast<int32_t>(idle_timeout.count()) : -1;
+    const auto idle_timeout_ns = static_cast<uint64_t>(
+        std::chrono::nanoseconds(idle_timeout).count());
+
+    m_loop_time = read_clock();
+    auto last_active = m_loop_time;
+
+    auto handle = [&](EventListener *listener, EventType type, bool resume) {
+        const uint64_t start = measure ? WorkerStats::now() : 0;
+        bool is_deferred = false;
+
+        if (listener->is_edge_triggered()) {
+            is_deferred = dispatch_edge_triggered(*listener, type, resume);
+        } else {
+            // EPOLLONESHOT guarantees that no other thread holds an event
+            // for this listener until we re-register it. Mode changes by
+            // other threads (e.g. when sending) re-arm it early, though.
+            auto &state = listener->m_event_state;
+
+            if (!resume &&
+                (state.fetch_or(LISTENER_OWNED) & LISTENER_OWNED) != 0U) {
+                // The owner re-registers the listener once it is done, so
+                // the event will be reported again
+                return;
+            }
+
+            dispatch(*listener, type);
+            is_deferred = std::exchange(listener->m_read_deferred, false);
+
+            if (!is_deferred) {
+                state.fetch_and(~LISTENER_OWNED);
+            }
+        }
+
+        if (measure) {
+            stats.queue_delay.record(start - wakeup_time);
+            stats.handler_time.record(WorkerStats::now() - start);
+        }
+
+        if (is_deferred) {
+            // Rare, so holding a reference is fine here
+            deferred.push_back(listener->shared_from_this());
+        } else if (!listener->is_edge_triggered()) {
+            listener->re_register(false);
+        }
+    };
+
+    while (m_okay) {
+        events.clear();
+        const bool keep_running =
+            update(shard, reader, raw_events.data(), events, expired, stats,
+                   deferred.empty(), timeout);
+
+        stats.add_wakeup();
+        stats.add_events(events.size());
+
+        wakeup_time = measure ? WorkerStats::now() : 0;
+
+        for (auto &[listener, type] : events) {
+            handle(listener, type, false);
+        }
+
+        if (!events.empty()) {
+            // The borrowed listeners may be released from now on, including
+            // those that were unregistered while handling this batch
+            shard.event_listeners->exit(reader);
+            shard.event_listeners->collect();
+
+            expired.clear();
+        }
+
+        resumed.swap(deferred);
+
+        for (auto &listener : resumed) {
+            handle(listener.get(), EventType::Read, true);
+        }
 
-        if (listener == nullptr) {
+        resumed.clear();
+
+        if (!keep_running) {
             // terminate
             return;
         }
 
-        if (type == EventType::ReadWrite) {
-            VLOG(3) << "Got read/write event";
-            listener->on_read_ready();
-            listener->on_write_ready();
-        } else if (type == EventType::Read) {
-            VLOG(3) << "Got read event";
+        const bool ran_tasks = run_tasks(shard, stats);
 
-            listener->on_read_ready();
-        } else if (type == EventType::Write) {
-            VLOG(3) << "Got write event";
+        if (!m_elastic) {
+            continue;
+        }
 
-            listener->on_write_ready();
-        } else if (type == EventType::Error) {
-            VLOG(3) << "Got error event";
-            listener->on_error();
-        } else {
-            LOG(FATAL) << "Invalid event type!";
+        if (!events.empty() || ran_tasks || !deferred.empty()) {
+            last_active = m_loop_time;
+        } else if (m_loop_time - last_active >= idle_timeout_ns &&
+                   retire_worker(worker)) {
+            return;
         }
+    }
+}
+
+void EventLoop::start_worker(size_t worker) {
+    if (m_threads[worker].joinable()) {
+        // A worker that retired earlier; it is done already or about to be
+        m_threads[worker].join();
+    }
+
+    auto &shard = m_config.sharded ? *m_shards[worker] : *m_shards[0];
+    const size_t reader = m_config.sharded ? 0 : worker;
+
+    m_worker_active[worker] = true;
+    m_num_workers += 1;
 
-        listener->re_register(false);
+    // Leave asynchronous signals to other threads (or a SignalEventListener).
+    // The worker inherits the mask, so it is blocked from the start
+    sigset_t previous;
+
+    if (m_config.block_signals) {
+        block_async_signals(previous);
+    }
+
+    m_threads[worker] = std::thread(&EventLoop::thread_loop, this,
+                                    std::ref(shard), reader, worker);
+
+    if (m_config.block_signals) {
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
     }
 }
 
-void EventLoop::run() noexcept {
-    auto num_threads = m_num_threads;
+void EventLoop::spawn_worker() noexcept {
+    if (m_spawning.exchange(true)) {
+        return;
+    }
 
-    if (num_threads <= 0) {
-        num_threads =
-            2 * static_cast<int32_t>(std::thread::hardware_concurrency());
+    const std::unique_lock lock(m_threads_mutex);
 
-        if (num_threads <= 0) {
-            LOG(FATAL)
-                << "Could not detect number of hardware threads supported!";
+    if (!m_okay || m_num_workers >= m_num_threads) {
+        m_spawning = false;
+        return;
+    }
+
+    for (size_t worker = 0; worker < m_worker_active.size(); ++worker) {
+        if (!m_worker_active[worker]) {
+            VLOG(1) << "All workers are busy. Starting worker " << worker;
+            start_worker(worker);
+            return;
         }
     }
 
-    for (auto i = 0; i < num_threads; ++i) {
-        m_threads.emplace_back(&EventLoop::thread_loop, this);
+    m_spawning = false;
+}
+
+bool EventLoop::retire_worker(size_t worker) noexcept {
+    const std::unique_lock lock(m_threads_mutex);
+
+    if (m_num_workers <= m_config.min_threads) {
+        return false;
     }
 
-    LOG(INFO) << "Created new event loop with " << num_threads << " threads";
+    VLOG(1) << "Worker " << worker << " was idle. Stopping it.";
+
+    // The thread is joined once the slot is used again (or by wait())
+    m_worker_active[worker] = false;
+    m_num_workers -= 1;
+
+    return true;
+}
+
+void EventLoop::dispatch(EventListener &listener, EventType type) {
+    const auto fileno = trace::is_enabled() ? listener.get_fileno() : -1;
+
+    if (type == EventType::ReadWrite) {
+        VLOG(3) << "Got read/write event";
+        {
+            const trace::Span span("on_read_ready", fileno);
+            listener.on_read_ready();
+        }
+        {
+            const trace::Span span("on_write_ready", fileno);
+            listener.on_write_ready();
+        }
+    } else if (type == EventType::Read) {
+        VLOG(3) << "Got read event";
+
+        const trace::Span span("on_read_ready", fileno);
+        listener.on_read_ready();
+    } else if (type == EventType::Write) {
+        VLOG(3) << "Got write event";
+
+        const trace::Span span("on_write_ready", fileno);
+        listener.on_write_ready();
+    } else if (type == EventType::Error) {
+        VLOG(3) << "Got error event";
+
+        const trace::Span span("on_error", fileno);
+        listener.on_error();
+    } else {
+        LOG(FATAL) << "Invalid event type!";
+    }
+}
+
+bool EventLoop::dispatch_edge_triggered(EventListener &listener,
+                                        EventType type, bool resume) {
+    uint32_t pending = 0;
+
+    if (type == EventType::ReadWrite) {
+        pending = LISTENER_PENDING_READ | LISTENER_PENDING_WRITE;
+    } else if (type == EventType::Read) {
+        pending = LISTENER_PENDING_READ;
+    } else if (type == EventType::Write) {
+        pending = LISTENER_PENDING_WRITE;
+    } else {
+        pending = LISTENER_PENDING_ERROR;
+    }
+
+    auto &state = listener.m_event_state;
+
+    if (resume) {
+        state.fetch_or(pending);
+    } else if ((state.fetch_or(LISTENER_OWNED | pending) & LISTENER_OWNED) !=
+               0U) {
+        // Another thread is handling this listener and will pick up the event
+        return false;
+    }
+
+    while (true) {
+        pending = state.fetch_and(LISTENER_OWNED) & ~LISTENER_OWNED;
+
+        if (pending == 0) {
+            auto expected = LISTENER_OWNED;
+
+            if (state.compare_exchange_strong(expected, 0)) {
+                return false;
+            }
+
+            // Got new events in the meantime
+            continue;
+        }
+
+        const bool has_read = (pending & LISTENER_PENDING_READ) != 0U;
+        const bool has_write = (pending & LISTENER_PENDING_WRITE) != 0U;
+
+        if (has_read && has_write) {
+            dispatch(listener, EventType::ReadWrite);
+        } else if (has_read) {
+            dispatch(listener, EventType::Read);
+        } else if (has_write) {
+            dispatch(listener, EventType::Write);
+        } else {
+            dispatch(listener, EventType::Error);
+        }
+
+        if (std::exchange(listener.m_read_deferred, false)) {
+            // Keep ownership, so events that arrive in the meantime are
+            // handled once reading resumes
+            return true;
+        }
+    }
+}
+
+void EventLoop::run() noexcept {
+    const std::unique_lock lock(m_threads_mutex);
+    const int32_t num_threads =
+        m_elastic ? m_config.min_threads : m_num_threads;
+
+    for (int32_t worker = 0; worker < num_threads; ++worker) {
+        start_worker(worker);
+    }
+
+    if (m_config.sharded) {
+        LOG(INFO) << "Created new sharded event loop with " << m_num_threads
+                  << " threads";
+    } else if (m_elastic) {
+        LOG(INFO) << "Created new elastic event loop with " << num_threads
+                  << " to " << m_num_threads << " threads";
+    } else {
+        LOG(INFO) << "Created new event loop with " << m_num_threads
+                  << " threads";
+    }
 }
 
 void EventLoop::wait() noexcept {
-    for (auto &t : m_threads) {
-        t.join();
+    // Workers might be started (and retire) in the meantime
+    while (true) {
+        std::thread thread;
+
+        {
+            const std::unique_lock lock(m_threads_mutex);
+
+            for (auto &t : m_threads) {
+                if (t.joinable()) {
+                    thread = std::move(t);
+                    break;
+                }
+            }
+        }
+
+        if (!thread.joinable()) {
+            return;
+        }
+
+        thread.join();
     }
 }
 
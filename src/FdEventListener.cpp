@@ -0,0 +1,114 @@
+#include <unistd.h>
+#include <yael/EventLoop.h>
+#include <yael/FdEventListener.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace yael {
+
+FdEventListener::FdEventListener(int32_t fd, Callback on_readable,
+                                 Callback on_writable, Callback on_error,
+                                 bool owns_fd)
+    : m_fileno(fd), m_fd(fd), m_owns_fd(owns_fd),
+      m_on_readable(std::move(on_readable)),
+      m_on_writable(std::move(on_writable)), m_on_error(std::move(on_error)) {
+    if (fd < 0) {
+        throw std::invalid_argument("Not a valid file descriptor");
+    }
+}
+
+FdEventListener::~FdEventListener() {
+    if (m_fd >= 0 && m_owns_fd) {
+        ::close(m_fd);
+    }
+}
+
+void FdEventListener::close_socket() {
+    std::unique_lock lock(m_mutex);
+
+    if (m_fd < 0) {
+        return;
+    }
+
+    // Remove it from the poller before the fd number can be reused
+    const auto fd = std::exchange(m_fd, -1);
+    lock.unlock();
+
+    if (auto *el = event_loop()) {
+        el->unregister_event_listener(shared_from_this());
+    }
+
+    if (m_owns_fd) {
+        ::close(fd);
+    }
+}
+
+void FdEventListener::set_mode(EventListener::Mode mode) {
+    std::unique_lock lock(m_mutex);
+
+    if (mode == m_mode) {
+        return;
+    }
+
+    m_mode = mode;
+
+    if (m_fd < 0) {
+        return;
+    }
+
+    lock.unlock();
+
+    if (auto *el = event_loop()) {
+        el->notify_listener_mode_change(*this, mode, false);
+    }
+}
+
+void FdEventListener::re_register(bool first_time) {
+    std::unique_lock lock(m_mutex);
+
+    if (m_fd < 0) {
+        VLOG(1) << "Cannot (re-)register. Fd event listener invalid.";
+        return;
+    }
+
+    const auto mode = m_mode;
+    lock.unlock();
+
+    if (auto *el = event_loop()) {
+        el->notify_listener_mode_change(*this, mode, first_time);
+    }
+}
+
+void FdEventListener::on_read_ready() {
+    if (!is_valid()) {
+        return;
+    }
+
+    if (m_on_readable) {
+        m_on_readable(*this);
+        return;
+    }
+
+    // Hangups are reported as readable. Without a callback to handle them
+    // (or any input), the fd would stay ready and keep waking up workers.
+    on_error();
+}
+
+void FdEventListener::on_write_ready() {
+    if (m_on_writable && is_valid()) {
+        m_on_writable(*this);
+    }
+}
+
+void FdEventListener::on_error() {
+    if (m_on_error && is_valid()) {
+        m_on_error(*this);
+    } else {
+        LOG(WARNING) << "Got error; closing fd " << m_fileno;
+    }
+
+    close_socket();
+}
+
+} // namespace yael
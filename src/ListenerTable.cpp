@@ -0,0 +1,194 @@
+#include "ListenerTable.h"
+
+#include <glog/logging.h>
+
+#include <limits>
+
+namespace yael {
+
+ListenerTable::ListenerTable(size_t num_readers)
+    : m_readers(new reader_t[num_readers]), m_num_readers(num_readers) {}
+
+ListenerTable::~ListenerTable() {
+    for (auto &segment : m_segments) {
+        delete segment.load();
+    }
+}
+
+EventListener *ListenerTable::lookup(int32_t fileno) const {
+    if (fileno < 0) {
+        return nullptr;
+    }
+
+    const auto seg_idx = fileno >> SEGMENT_BITS;
+
+    if (seg_idx >= MAX_SEGMENTS) {
+        return nullptr;
+    }
+
+    auto *segment = m_segments[seg_idx].load(std::memory_order_acquire);
+
+    if (segment == nullptr) {
+        return nullptr;
+    }
+
+    // Has to be sequentially consistent with the epoch announced in enter()
+    return segment->listeners[fileno & (SEGMENT_SIZE - 1)].load(
+        std::memory_order_seq_cst);
+}
+
+void ListenerTable::enter(size_t reader) {
+    DCHECK(reader < m_num_readers);
+
+    auto epoch = m_epoch.load(std::memory_order_seq_cst);
+    m_readers[reader].epoch.store(epoch, std::memory_order_seq_cst);
+}
+
+void ListenerTable::exit(size_t reader) {
+    m_readers[reader].epoch.store(0, std::memory_order_release);
+}
+
+void ListenerTable::insert(int32_t fileno, EventListenerPtr listener) {
+    if (fileno < 0 || (fileno >> SEGMENT_BITS) >= MAX_SEGMENTS) {
+        LOG(FATAL) << "Cannot register listener: invalid fileno " << fileno;
+    }
+
+    std::vector<EventListenerPtr> released;
+    std::unique_lock lock(m_mutex);
+
+    const auto seg_idx = fileno >> SEGMENT_BITS;
+    const auto idx = fileno & (SEGMENT_SIZE - 1);
+
+    auto *segment = m_segments[seg_idx].load(std::memory_order_relaxed);
+
+    if (segment == nullptr) {
+        segment = new segment_t();
+        m_segments[seg_idx].store(segment, std::memory_order_release);
+    }
+
+    while (segment->owners[idx] != nullptr) {
+        // wait for other thread to process old event listener disconnect
+        m_cond.wait(lock);
+    }
+
+    segment->listeners[idx].store(listener.get(), std::memory_order_seq_cst);
+    segment->owners[idx] = std::move(listener);
+    m_size++;
+
+    reclaim(released);
+}
+
+bool ListenerTable::erase(int32_t fileno,
+                          const std::function<void()> &on_erase) {
+    if (fileno < 0 || (fileno >> SEGMENT_BITS) >= MAX_SEGMENTS) {
+        return false;
+    }
+
+    // Declared before the lock, so listeners are released after unlocking
+    std::vector<EventListenerPtr> released;
+    const std::unique_lock lock(m_mutex);
+
+    auto *segment =
+        m_segments[fileno >> SEGMENT_BITS].load(std::memory_order_relaxed);
+
+    if (segment == nullptr) {
+        return false;
+    }
+
+    const auto idx = fileno & (SEGMENT_SIZE - 1);
+    auto &owner = segment->owners[idx];
+
+    if (owner == nullptr) {
+        return false;
+    }
+
+    if (on_erase) {
+        on_erase();
+    }
+
+    segment->listeners[idx].store(nullptr, std::memory_order_seq_cst);
+
+    // Readers that entered in this epoch (or earlier) might still see it
+    auto epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    m_retired.emplace_back(epoch, std::move(owner));
+    m_num_retired = m_retired.size();
+    owner = nullptr;
+
+    m_size--;
+    m_cond.notify_all();
+
+    reclaim(released);
+    return true;
+}
+
+void ListenerTable::reclaim(std::vector<EventListenerPtr> &released) {
+    if (m_retired.empty()) {
+        return;
+    }
+
+    auto min_epoch = std::numeric_limits<uint64_t>::max();
+
+    for (size_t i = 0; i < m_num_readers; ++i) {
+        auto epoch = m_readers[i].epoch.load(std::memory_order_seq_cst);
+
+        if (epoch != 0) {
+            min_epoch = std::min(min_epoch, epoch);
+        }
+    }
+
+    auto it = m_retired.begin();
+
+    while (it != m_retired.end()) {
+        if (it->first < min_epoch) {
+            released.emplace_back(std::move(it->second));
+            it = m_retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    m_num_retired = m_retired.size();
+}
+
+void ListenerTable::collect() {
+    if (m_num_retired.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    // Declared before the lock, so listeners are released after unlocking
+    std::vector<EventListenerPtr> released;
+    const std::unique_lock lock(m_mutex);
+
+    reclaim(released);
+}
+
+std::vector<EventListenerPtr> ListenerTable::snapshot() {
+    std::vector<EventListenerPtr> result;
+    const std::unique_lock lock(m_mutex);
+
+    for (auto &entry : m_segments) {
+        auto *segment = entry.load(std::memory_order_relaxed);
+
+        if (segment == nullptr) {
+            continue;
+        }
+
+        for (auto &owner : segment->owners) {
+            if (owner != nullptr) {
+                result.push_back(owner);
+            }
+        }
+    }
+
+    return result;
+}
+
+void ListenerTable::wait_empty() {
+    std::unique_lock lock(m_mutex);
+
+    while (m_size > 0) {
+        m_cond.wait(lock);
+    }
+}
+
+} // namespace yael
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "yael/EventListener.h"
+
+namespace yael {
+
+/**
+ * Maps filenos to event listeners
+ *
+ * Filenos are small dense integers, so the table is a flat array that grows
+ * in fixed-size segments. Segments never move once allocated, which allows
+ * lookups without taking a lock.
+ *
+ * Readers announce the epoch they are reading in. A removed listener is
+ * retired and its reference is only dropped once no reader can still be
+ * looking at it.
+ */
+class ListenerTable {
+  public:
+    explicit ListenerTable(size_t num_readers);
+    ~ListenerTable();
+
+    ListenerTable(const ListenerTable &other) = delete;
+
+    /**
+     * Add a new listener
+     * If another listener is still registered with the same fileno, this will
+     * block until it has been removed
+     */
+    void insert(int32_t fileno, EventListenerPtr listener);
+
+    /**
+     * Remove the listener for the specified fileno
+     * @param on_erase invoked while holding the writer lock, before the slot
+     *        can be taken by a new listener
+     * @return false if there was no such listener
+     */
+    bool erase(int32_t fileno, const std::function<void()> &on_erase = {});
+
+    /// Is there a listener for this fileno? (does not require an epoch)
+    [[nodiscard]]
+    bool contains(int32_t fileno) const {
+        return lookup(fileno) != nullptr;
+    }
+
+    /**
+     * Get the listener for the specified fileno (if any)
+     * @note the result may only be dereferenced between enter() and exit()
+     */
+    [[nodiscard]]
+    EventListener *lookup(int32_t fileno) const;
+
+    /// Start a read-side critical section for the specified reader
+    void enter(size_t reader);
+
+    /// End a read-side critical section
+    void exit(size_t reader);
+
+    /**
+     * Release retired listeners no reader can see anymore
+     * Otherwise, this only happens when the table is modified. Cheap if there is nothing to release.
+     */
+    void collect();
+
+    [[nodiscard]]
+    size_t size() const {
+        return m_size;
+    }
+
+    /// Get a copy of all listeners currently in the table
+    std::vector<EventListenerPtr> snapshot();
+
+    /// Block until the table is empty
+    void wait_empty();
+
+  private:
+    static constexpr int32_t SEGMENT_BITS = 10;
+    static constexpr int32_t SEGMENT_SIZE = 1 << SEGMENT_BITS;
+    static constexpr int32_t MAX_SEGMENTS = 4096;
+
+    struct segment_t {
+        std::array<std::atomic<EventListener *>, SEGMENT_SIZE> listeners = {};
+
+        /// Keeps the listeners alive (only accessed by writers)
+        std::array<EventListenerPtr, SEGMENT_SIZE> owners;
+    };
+
+    struct alignas(64) reader_t {
+        /// The epoch this reader is in, or zero if it is not reading
+        std::atomic<uint64_t> epoch = 0;
+    };
+
+    /// Release retired listeners no reader can see anymore
+    /// @note needs to hold the writer lock
+    void reclaim(std::vector<EventListenerPtr> &released);
+
+    std::array<std::atomic<segment_t *>, MAX_SEGMENTS> m_segments = {};
+
+    std::unique_ptr<reader_t[]> m_readers;
+    const size_t m_num_readers;
+
+    std::atomic<uint64_t> m_epoch = 1;
+    std::atomic<size_t> m_size = 0;
+
+    /// Serializes writers
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+
+    std::vector<std::pair<uint64_t, EventListenerPtr>> m_retired;
+
+    /// Allows checking for retired listeners without taking the lock
+    std::atomic<size_t> m_num_retired = 0;
+};
+
+} // namespace yael
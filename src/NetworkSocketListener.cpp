@@ -1,6 +1,31 @@
 #include "yael/NetworkSocketListener.h"
 
 #include "yael/EventLoop.h"
+#include "yael/TimeEventListener.h"
+#include "yael/Trace.h"
+#include "yael/network/TcpSocket.h"
+
+namespace yael {
+
+/// Gives up on a connection attempt that takes too long
+class ConnectTimer : public TimeEventListener {
+  public:
+    explicit ConnectTimer(std::weak_ptr<NetworkSocketListener> listener)
+        : m_listener(std::move(listener)) {}
+
+    void on_time_event() override {
+        close_socket();
+
+        if (auto listener = m_listener.lock()) {
+            listener->on_connect_timeout();
+        }
+    }
+
+  private:
+    std::weak_ptr<NetworkSocketListener> m_listener;
+};
+
+} // namespace yael
 
 using namespace yael;
 
@@ -24,24 +49,111 @@ std::unique_ptr<network::Socket> NetworkSocketListener::release_socket() {
 
     /// FIXME we should tell event listener to remap the socket
     // the current approach can cause race conditions...
-    auto &el = EventLoop::get_instance();
-    el.unregister_event_listener(
-        std::dynamic_pointer_cast<EventListener>(shared_from_this()));
+    if (auto *el = event_loop()) {
+        el->unregister_event_listener(
+            std::dynamic_pointer_cast<EventListener>(shared_from_this()));
+    }
 
     return sock;
 }
 
 void NetworkSocketListener::re_register(bool first_time) {
     // send queue decides the mode of the listener
-    const std::unique_lock lock(m_send_mutex);
+    std::unique_lock lock(m_send_mutex);
 
     if (!m_socket->is_valid()) {
         // we're done
         return;
     }
 
-    auto &el = EventLoop::get_instance();
-    el.notify_listener_mode_change(shared_from_this(), m_mode, first_time);
+    auto *el = event_loop();
+
+    if (el != nullptr) {
+        el->notify_listener_mode_change(*this, m_mode, first_time);
+    }
+
+    lock.unlock();
+
+    if (first_time && el != nullptr && m_connecting &&
+        m_connect_timeout.count() > 0) {
+        auto self = std::dynamic_pointer_cast<NetworkSocketListener>(
+            shared_from_this());
+        auto timer = el->make_event_listener<ConnectTimer>(self);
+
+        {
+            const std::unique_lock connect_lock(m_connect_mutex);
+            m_connect_timer = timer;
+        }
+
+        timer->schedule(static_cast<uint64_t>(m_connect_timeout.count()));
+
+        // The connection might have been established in the meantime
+        if (!m_connecting) {
+            stop_connect_timer();
+        }
+    }
+}
+
+bool NetworkSocketListener::connect_async(
+    std::unique_ptr<network::Socket> &&socket, const network::Address &address,
+    std::chrono::milliseconds timeout) {
+    if (!socket->connect_async(address)) {
+        return false;
+    }
+
+    m_connecting = true;
+    m_connect_timeout = timeout;
+
+    NetworkSocketListener::set_socket(std::move(socket),
+                                      SocketType::Connection);
+
+    // Connecting finishes with the socket becoming writable
+    const std::unique_lock lock(m_send_mutex);
+    m_mode = Mode::ReadWrite;
+
+    return true;
+}
+
+bool NetworkSocketListener::update_connection_state() {
+    try {
+        if (!m_socket->finish_connect()) {
+            return false;
+        }
+    } catch (const network::socket_error &e) {
+        LOG(WARNING) << e.what();
+        close_socket();
+        return false;
+    }
+
+    if (m_socket->is_connected()) {
+        connection_established();
+    }
+
+    return true;
+}
+
+void NetworkSocketListener::connection_established() {
+    if (m_connecting.exchange(false)) {
+        stop_connect_timer();
+        this->on_connected();
+    }
+}
+
+void NetworkSocketListener::on_connect_timeout() {
+    if (m_connecting) {
+        LOG(WARNING) << "Connecting timed out (fileno=" << m_fileno << ")";
+        force_close();
+    }
+}
+
+void NetworkSocketListener::stop_connect_timer() {
+    std::unique_lock lock(m_connect_mutex);
+    auto timer = std::move(m_connect_timer);
+    lock.unlock();
+
+    if (timer) {
+        timer->close_socket();
+    }
 }
 
 void NetworkSocketListener::set_mode(EventListener::Mode mode) {
@@ -51,8 +163,9 @@ void NetworkSocketListener::set_mode(EventListener::Mode mode) {
 
     m_mode = mode;
 
-    auto &el = EventLoop::get_instance();
-    el.notify_listener_mode_change(shared_from_this(), mode, false);
+    if (auto *el = event_loop()) {
+        el->notify_listener_mode_change(*this, mode, false);
+    }
 }
 
 void NetworkSocketListener::set_socket(
@@ -71,6 +184,11 @@ void NetworkSocketListener::set_socket(
     m_socket = std::move(socket);
     m_socket_type = type;
     m_fileno = m_socket->get_fileno();
+
+    // There is one such acceptor per shard (see make_reuse_port_acceptors)
+    const auto *tcp = dynamic_cast<const network::TcpSocket *>(m_socket.get());
+    m_local_accept =
+        type == SocketType::Acceptor && tcp != nullptr && tcp->reuse_port();
 }
 
 bool NetworkSocketListener::is_valid() {
@@ -94,6 +212,11 @@ bool NetworkSocketListener::is_connected() {
 }
 
 void NetworkSocketListener::on_write_ready() {
+    if (m_connecting && !update_connection_state()) {
+        // Wait for the next write event
+        return;
+    }
+
     std::unique_lock lock(m_send_mutex);
 
     bool has_more;
@@ -112,6 +235,13 @@ void NetworkSocketListener::on_write_ready() {
 
     if (!has_more && is_valid()) {
         set_mode(EventListener::Mode::ReadOnly);
+
+        // The callback might send more data
+        if (lock.owns_lock()) {
+            lock.unlock();
+        }
+
+        on_send_queue_drained();
     }
 }
 
@@ -280,11 +410,16 @@ void NetworkSocketListener::on_error() {
 }
 
 void NetworkSocketListener::on_read_ready() {
+    if (m_connecting && !update_connection_state()) {
+        return;
+    }
+
     std::unique_lock lock(m_mutex);
 
     switch (m_socket_type) {
     case SocketType::Acceptor: {
         auto result = m_socket->accept();
+        const EventLoop::LocalShardScope scope(m_local_accept);
         lock.unlock();
 
         for (auto &s : result) {
@@ -294,13 +429,28 @@ void NetworkSocketListener::on_read_ready() {
         break;
     }
     case SocketType::Connection: {
+        auto *el = event_loop();
+        const uint32_t budget = el != nullptr ? el->read_budget() : 0;
+        uint32_t num_messages = 0;
+
         try {
             while (m_socket) {
+                if (budget > 0 && num_messages >= budget) {
+                    // Let other connections go first
+                    defer_read();
+                    break;
+                }
+
                 auto message = m_socket->receive();
 
                 if (message) {
+                    num_messages += 1;
                     lock.unlock();
-                    this->on_network_message(*message);
+                    {
+                        const trace::Span span("on_network_message",
+                                               m_fileno);
+                        this->on_network_message(*message);
+                    }
                     lock.lock();
                 } else {
                     // no more data
@@ -315,6 +465,10 @@ void NetworkSocketListener::on_read_ready() {
         // the socket is closed
         if (m_socket && !m_socket->is_valid()) {
             close_socket_internal(lock);
+        } else if (m_connecting && m_socket && m_socket->is_connected()) {
+            // The TLS handshake completed
+            lock.unlock();
+            connection_established();
         }
 
         break;
@@ -324,12 +478,34 @@ void NetworkSocketListener::on_read_ready() {
     }
 }
 
+void NetworkSocketListener::on_drain() {
+    std::unique_lock lock(m_mutex);
+
+    if (m_socket_type == SocketType::Acceptor) {
+        close_socket_internal(lock);
+    }
+}
+
+bool NetworkSocketListener::is_drained() {
+    const std::unique_lock lock(m_send_mutex);
+
+    // The listener only switches back to read-only mode once do_send() has
+    // no more data to send
+    return m_mode == Mode::ReadOnly &&
+           (!m_socket || m_socket->send_queue_size() == 0);
+}
+
+void NetworkSocketListener::force_close() {
+    std::unique_lock lock(m_mutex);
+    close_socket_internal(lock, true);
+}
+
 void NetworkSocketListener::close_socket_internal(
-    std::unique_lock<std::mutex> &lock) {
+    std::unique_lock<std::mutex> &lock, bool fast) {
     bool done = true;
 
     if (m_socket && m_socket->is_valid()) {
-        done = m_socket->close();
+        done = m_socket->close(fast);
         lock.unlock();
     }
 
@@ -337,13 +513,15 @@ void NetworkSocketListener::close_socket_internal(
         // make sure we invoke the callback at most once
         m_has_disconnected = true;
 
-        if (m_socket_type == SocketType::Connection) {
+        if (m_connecting.exchange(false)) {
+            stop_connect_timer();
+            this->on_connect_failed();
+        } else if (m_socket_type == SocketType::Connection) {
             this->on_disconnect();
         }
 
-        if (EventLoop::is_initialized()) {
-            auto &el = EventLoop::get_instance();
-            el.unregister_event_listener(shared_from_this());
+        if (auto *el = event_loop()) {
+            el->unregister_event_listener(shared_from_this());
         }
     }
 }
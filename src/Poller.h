@@ -0,0 +1,47 @@
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace yael {
+
+/**
+ * Readiness notification mechanism used by a shard of the event loop
+ *
+ * Interest sets and events use the EPOLL* flags, regardless of the
+ * implementation. Registering with EPOLLONESHOT requires the fileno to be
+ * re-armed using modify() after every event.
+ */
+class Poller {
+  public:
+    virtual ~Poller() = default;
+
+    virtual bool add(int32_t fileno, uint32_t flags) = 0;
+
+    virtual bool modify(int32_t fileno, uint32_t flags) = 0;
+
+    virtual bool remove(int32_t fileno) = 0;
+
+    /**
+     * Wait for events
+     * @param timeout in milliseconds, or -1 to wait indefinitely
+     * @return the number of events, or -1 on error (errno will be set)
+     */
+    virtual int wait(epoll_event *events, int max_events, int timeout) = 0;
+
+    /// Can more than one thread call wait() at the same time?
+    [[nodiscard]]
+    virtual bool is_thread_safe() const = 0;
+};
+
+std::unique_ptr<Poller> make_epoll_poller();
+
+/**
+ * Create a poller built on io_uring
+ * @return nullptr if the kernel does not support the required features
+ */
+std::unique_ptr<Poller> make_uring_poller(uint32_t num_entries);
+
+} // namespace yael
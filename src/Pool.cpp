@@ -0,0 +1,106 @@
+#include "yael/Pool.h"
+
+#include <array>
+#include <cstdint>
+
+namespace yael {
+
+namespace {
+
+/// Sizes are rounded up to a multiple of this
+constexpr size_t SIZE_CLASS_GRANULARITY = 64;
+
+constexpr size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE / SIZE_CLASS_GRANULARITY;
+
+struct free_block_t {
+    free_block_t *next;
+};
+
+struct free_list_t {
+    free_block_t *head = nullptr;
+    size_t length = 0;
+};
+
+/// The free lists of a thread; blocks are returned to the heap on thread exit
+class ThreadPool {
+  public:
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool &other) = delete;
+
+    ~ThreadPool();
+
+    std::array<free_list_t, NUM_SIZE_CLASSES> free_lists;
+};
+
+/// Set once the pool of this thread has been destroyed (it is trivially
+/// destructible, so it can still be accessed afterwards)
+thread_local bool pool_destroyed = false;
+
+thread_local ThreadPool thread_pool;
+
+ThreadPool::~ThreadPool() {
+    pool_destroyed = true;
+
+    for (auto &list : free_lists) {
+        while (list.head != nullptr) {
+            auto *block = list.head;
+            list.head = block->next;
+
+            ::operator delete(block);
+        }
+
+        list.length = 0;
+    }
+}
+
+inline size_t get_size_class(size_t size) {
+    return (size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY - 1;
+}
+
+} // namespace
+
+void *pool_allocate(size_t size) {
+    if (size == 0 || size > MAX_POOLED_SIZE || pool_destroyed) {
+        return ::operator new(size);
+    }
+
+    const auto size_class = get_size_class(size);
+    auto &list = thread_pool.free_lists[size_class];
+
+    if (list.head == nullptr) {
+        // All blocks of a size class have the same size, so that they can be
+        // reused for any allocation in that class
+        return ::operator new((size_class + 1) * SIZE_CLASS_GRANULARITY);
+    }
+
+    auto *block = list.head;
+    list.head = block->next;
+    list.length -= 1;
+
+    return block;
+}
+
+void pool_deallocate(void *ptr, size_t size) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    if (size == 0 || size > MAX_POOLED_SIZE || pool_destroyed) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto &list = thread_pool.free_lists[get_size_class(size)];
+
+    if (list.length >= MAX_POOLED_BLOCKS) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto *block = static_cast<free_block_t *>(ptr);
+    block->next = list.head;
+    list.head = block;
+    list.length += 1;
+}
+
+} // namespace yael
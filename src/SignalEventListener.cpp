@@ -0,0 +1,105 @@
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <yael/EventLoop.h>
+#include <yael/SignalEventListener.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace yael {
+
+SignalEventListener::SignalEventListener(std::initializer_list<int> signals) {
+    sigset_t mask;
+    sigemptyset(&mask);
+
+    for (auto signo : signals) {
+        sigaddset(&mask, signo);
+    }
+
+    // Otherwise the signals would still be handled the default way
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        LOG(FATAL) << "Failed to block signals";
+    }
+
+    m_fileno = m_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (m_fd < 0) {
+        LOG(FATAL) << "Failed to create signalfd: " << strerror(errno);
+    }
+}
+
+SignalEventListener::~SignalEventListener() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+void SignalEventListener::close_socket() {
+    std::unique_lock lock(m_mutex);
+
+    if (m_fd < 0) {
+        return;
+    }
+
+    // Remove it from the poller before the fd number can be reused
+    const auto fd = std::exchange(m_fd, -1);
+    lock.unlock();
+
+    if (auto *el = event_loop()) {
+        el->unregister_event_listener(shared_from_this());
+    }
+
+    ::close(fd);
+}
+
+void SignalEventListener::on_error() {
+    LOG(WARNING) << "Got error; closing socket";
+    close_socket();
+}
+
+void SignalEventListener::re_register(bool first_time) {
+    if (!is_valid()) {
+        VLOG(1) << "Cannot (re-)register. Signal event listener invalid.";
+        return;
+    }
+
+    if (auto *el = event_loop()) {
+        el->notify_listener_mode_change(*this, EventListener::Mode::ReadOnly,
+                                        first_time);
+    }
+}
+
+void SignalEventListener::on_read_ready() {
+    std::unique_lock lock(m_mutex);
+    std::vector<int> received;
+
+    while (m_fd >= 0) {
+        signalfd_siginfo info;
+        auto res = ::read(m_fd, &info, sizeof(info));
+
+        if (res != sizeof(info)) {
+            if (res < 0 && errno != EAGAIN) {
+                LOG(ERROR) << "Failed to read from signalfd: "
+                           << strerror(errno);
+            }
+
+            break;
+        }
+
+        received.push_back(static_cast<int>(info.ssi_signo));
+    }
+
+    // The callback might close the listener
+    lock.unlock();
+
+    for (auto signo : received) {
+        VLOG(1) << "Received signal " << signo;
+        this->on_signal(signo);
+    }
+}
+
+} // namespace yael
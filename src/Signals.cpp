@@ -0,0 +1,23 @@
+#include "Signals.h"
+
+#include <glog/logging.h>
+#include <pthread.h>
+
+namespace yael {
+
+void block_async_signals(sigset_t &previous) {
+    sigset_t mask;
+    sigfillset(&mask);
+
+    // Signals caused by the thread itself have to be handled by it
+    for (auto signo :
+         {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGTRAP, SIGABRT, SIGSYS}) {
+        sigdelset(&mask, signo);
+    }
+
+    if (pthread_sigmask(SIG_BLOCK, &mask, &previous) != 0) {
+        LOG(ERROR) << "Failed to block signals";
+    }
+}
+
+} // namespace yael
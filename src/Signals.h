@@ -0,0 +1,18 @@
+#pragma once
+
+#include <csignal>
+
+namespace yael {
+
+/**
+ * Block asynchronous signals for the calling thread
+ *
+ * Threads inherit the mask of the thread that creates them. Block signals
+ * before creating internal threads (and restore the mask afterwards), so
+ * signals go to application threads (or a SignalEventListener) instead.
+ *
+ * @param previous set to the signal mask before
+ */
+void block_async_signals(sigset_t &previous);
+
+} // namespace yael
@@ -0,0 +1,140 @@
+#include "yael/Stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace yael {
+
+Histogram::Histogram(const Histogram &other) noexcept { *this = other; }
+
+Histogram &Histogram::operator=(const Histogram &other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    for (uint32_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        m_buckets[idx].store(
+            other.m_buckets[idx].load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+    }
+
+    m_count.store(other.count(), std::memory_order_relaxed);
+    m_sum.store(other.m_sum.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    m_max.store(other.max(), std::memory_order_relaxed);
+
+    return *this;
+}
+
+uint32_t Histogram::get_bucket(uint64_t value) noexcept {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<uint32_t>(value);
+    }
+
+    const auto msb = 63U - static_cast<uint32_t>(__builtin_clzll(value));
+    const auto shift = msb - SUB_BUCKET_BITS;
+    const auto sub_bucket =
+        static_cast<uint32_t>(value >> shift) - SUB_BUCKET_COUNT;
+
+    return SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t Histogram::get_bucket_upper_bound(uint32_t bucket) noexcept {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+
+    const auto shift = (bucket - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+    const auto sub_bucket = (bucket - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+    const auto lower = static_cast<uint64_t>(SUB_BUCKET_COUNT + sub_bucket)
+                       << shift;
+
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) noexcept {
+    // Only one thread records, so there is no need for atomic increments
+    auto inc = [](std::atomic<uint64_t> &counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    };
+
+    inc(m_buckets[get_bucket(value)], 1);
+    inc(m_count, 1);
+    inc(m_sum, value);
+
+    if (value > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::merge(const Histogram &other) noexcept {
+    for (uint32_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        m_buckets[idx].fetch_add(
+            other.m_buckets[idx].load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+    }
+
+    m_count.fetch_add(other.count(), std::memory_order_relaxed);
+    m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+    m_max.store(std::max(max(), other.max()), std::memory_order_relaxed);
+}
+
+double Histogram::mean() const noexcept {
+    const auto num = count();
+
+    if (num == 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(m_sum.load(std::memory_order_relaxed)) /
+           static_cast<double>(num);
+}
+
+uint64_t Histogram::percentile(double percentile) const noexcept {
+    const auto num = count();
+
+    if (num == 0) {
+        return 0;
+    }
+
+    percentile = std::clamp(percentile, 0.0, 100.0);
+
+    const auto target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(
+               std::ceil(percentile / 100.0 * static_cast<double>(num))));
+    uint64_t seen = 0;
+
+    for (uint32_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        seen += m_buckets[idx].load(std::memory_order_relaxed);
+
+        if (seen >= target) {
+            return std::min(get_bucket_upper_bound(idx), max());
+        }
+    }
+
+    return max();
+}
+
+void worker_stats_t::merge(const worker_stats_t &other) noexcept {
+    wakeups += other.wakeups;
+    events += other.events;
+    tasks += other.tasks;
+    busy_poll_hits += other.busy_poll_hits;
+
+    handler_time.merge(other.handler_time);
+    queue_delay.merge(other.queue_delay);
+}
+
+worker_stats_t event_loop_stats_t::total() const {
+    worker_stats_t result;
+
+    for (auto &worker : workers) {
+        result.merge(worker);
+    }
+
+    return result;
+}
+
+} // namespace yael
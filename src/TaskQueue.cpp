@@ -0,0 +1,104 @@
+#include "TaskQueue.h"
+
+#include <glog/logging.h>
+
+namespace yael {
+
+TaskQueue::TaskQueue(size_t capacity)
+    : m_mask(capacity - 1), m_cells(new cell_t[capacity]) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        LOG(FATAL) << "Task queue capacity has to be a power of two";
+    }
+
+    for (size_t i = 0; i < capacity; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+void TaskQueue::push(Closure &&task) {
+    if (!m_has_overflow.load(std::memory_order_acquire) && try_push(task)) {
+        return;
+    }
+
+    const std::unique_lock lock(m_overflow_mutex);
+    m_overflow.emplace_back(std::move(task));
+    m_has_overflow.store(true, std::memory_order_release);
+}
+
+bool TaskQueue::pop(Closure &task) {
+    if (try_pop(task)) {
+        return true;
+    }
+
+    if (!m_has_overflow.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const std::unique_lock lock(m_overflow_mutex);
+
+    if (m_overflow.empty()) {
+        return false;
+    }
+
+    task = std::move(m_overflow.front());
+    m_overflow.pop_front();
+
+    if (m_overflow.empty()) {
+        m_has_overflow.store(false, std::memory_order_release);
+    }
+
+    return true;
+}
+
+bool TaskQueue::try_push(Closure &task) {
+    auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto &cell = m_cells[pos & m_mask];
+        const auto seq = cell.sequence.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            if (m_enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                cell.task = std::move(task);
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // full
+            return false;
+        } else {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool TaskQueue::try_pop(Closure &task) {
+    auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto &cell = m_cells[pos & m_mask];
+        const auto seq = cell.sequence.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+        if (diff == 0) {
+            if (m_dequeue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                task = std::move(cell.task);
+                cell.sequence.store(pos + m_mask + 1,
+                                    std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // empty
+            return false;
+        } else {
+            pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace yael
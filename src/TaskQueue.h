@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "yael/Closure.h"
+
+namespace yael {
+
+/**
+ * Multi-producer multi-consumer queue for tasks posted to the event loop
+ *
+ * This is a bounded lock-free ring buffer (following Dmitry Vyukov's design).
+ * Tasks are stored inline, so posting does not allocate. Only if the ring is
+ * full, tasks spill over into a list protected by a mutex.
+ */
+class TaskQueue {
+  public:
+    /// @param capacity the size of the ring (has to be a power of two)
+    explicit TaskQueue(size_t capacity);
+
+    TaskQueue(const TaskQueue &other) = delete;
+
+    void push(Closure &&task);
+
+    /// @return false if there was no task
+    bool pop(Closure &task);
+
+  private:
+    bool try_push(Closure &task);
+    bool try_pop(Closure &task);
+
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        Closure task;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<cell_t[]> m_cells;
+
+    alignas(64) std::atomic<size_t> m_enqueue_pos = 0;
+    alignas(64) std::atomic<size_t> m_dequeue_pos = 0;
+
+    /// Set while there are tasks in the overflow list.
+    /// New tasks go to the list too, so tasks of a thread stay in order
+    alignas(64) std::atomic<bool> m_has_overflow = false;
+    std::mutex m_overflow_mutex;
+    std::deque<Closure> m_overflow;
+};
+
+} // namespace yael
@@ -1,49 +1,71 @@
-#include <sys/timerfd.h>
-#include <unistd.h>
 #include <yael/EventLoop.h>
 #include <yael/TimeEventListener.h>
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "TimerWheel.h"
+
 namespace yael {
 
-TimeEventListener::TimeEventListener() {
-    constexpr int32_t flags = 0;
-    m_fileno = m_fd = timerfd_create(CLOCK_REALTIME, flags);
-}
+TimeEventListener::TimeEventListener() = default;
 
 TimeEventListener::~TimeEventListener() = default;
 
 void TimeEventListener::close_socket() {
     std::unique_lock lock(m_mutex);
 
-    if (m_fd < 0) {
+    if (m_closed) {
         return;
     }
 
-    ::close(m_fd);
-    m_fd = -1;
+    m_closed = true;
+    m_queued_events.clear();
 
     lock.unlock();
 
-    if (EventLoop::is_initialized()) {
-        auto &el = EventLoop::get_instance();
-        el.unregister_event_listener(shared_from_this());
+    if (auto *el = event_loop()) {
+        el->unregister_event_listener(shared_from_this());
     }
 }
 
+bool TimeEventListener::is_drained() {
+    const std::unique_lock lock(m_mutex);
+
+    // The handler might schedule another event
+    if (m_firing) {
+        return false;
+    }
+
+    // Events that are not due before the event loop stops would be dropped
+    // anyway, so there is no point in waiting for them
+    auto *el = event_loop();
+    const auto deadline = el != nullptr
+                              ? el->m_drain_deadline.load()
+                              : std::numeric_limits<uint64_t>::max();
+
+    return m_queued_events.empty() || m_queued_events.front() > deadline;
+}
+
 void TimeEventListener::on_error() {
     LOG(WARNING) << "Got error; closing socket";
     close_socket();
 }
 
 void TimeEventListener::re_register(bool first_time) {
-    if (!is_valid()) {
-        VLOG(1) << "Cannot (re-)register. Time event listener invalid.";
+    if (!first_time) {
+        // The timing wheel is updated when events are handled
         return;
     }
 
-    auto &el = EventLoop::get_instance();
-    el.notify_listener_mode_change(shared_from_this(),
-                                   EventListener::Mode::ReadOnly, first_time);
+    const std::unique_lock lock(m_mutex);
+
+    // Events that were scheduled before registering
+    if (auto *wheel = get_timer_wheel();
+        wheel != nullptr && !m_queued_events.empty()) {
+        wheel->schedule(*this, m_queued_events.front());
+    }
 }
 
 void TimeEventListener::on_read_ready() {
@@ -51,82 +73,90 @@ void TimeEventListener::on_read_ready() {
 
     VLOG(2) << "Time event listener got woken up";
 
-    uint64_t buf;
-    auto res = ::read(m_fd, &buf, sizeof(buf));
+    auto now = get_loop_time_ns();
 
-    if (res != sizeof(buf)) {
-        LOG(FATAL) << "Failed to read from timefd";
+    // The event loop's clock might be coarser than the timing wheel's
+    if (auto *wheel = get_timer_wheel()) {
+        now = std::max(now, wheel->get_expiry(*this));
     }
 
-    if (buf == 1) {
-        auto now = get_current_time();
-        size_t count = 0;
-
-        while (true) {
-            if (m_queued_events.empty()) {
-                break;
-            }
-
-            auto it = m_queued_events.begin();
-            if (*it <= now) {
-                // erase before we invoke the callback
-                // because application code might call schedule()
-                m_queued_events.erase(it);
-                count++;
-            } else {
-                break;
-            }
-        }
+    size_t count = 0;
 
-        VLOG(2) << "Found " << count << " time event(s) to trigger";
+    while (!m_queued_events.empty() && m_queued_events.front() <= now) {
+        // erase before we invoke the callback
+        // because application code might call schedule()
+        std::pop_heap(m_queued_events.begin(), m_queued_events.end(),
+                      std::greater<>());
+        m_queued_events.pop_back();
+        count++;
+    }
 
-        lock.unlock();
-        for (size_t i = 0; i < count; ++i) {
-            this->on_time_event();
-        }
-        lock.lock();
+    VLOG(2) << "Found " << count << " time event(s) to trigger";
+
+    m_firing = count > 0;
+
+    lock.unlock();
+    for (size_t i = 0; i < count; ++i) {
+        this->on_time_event();
+    }
+    lock.lock();
 
-        if (!m_queued_events.empty() && m_fd >= 0) {
-            auto next = *m_queued_events.begin();
+    m_firing = false;
 
-            if (next < now) {
-                LOG(FATAL) << "Invalid state";
-            }
+    if (auto *wheel = get_timer_wheel()) {
+        wheel->finish(*this);
 
-            internal_schedule(next - now);
+        if (!m_queued_events.empty()) {
+            wheel->schedule(*this, m_queued_events.front());
         }
-    } else if (buf == 0) {
-        DLOG(WARNING) << "Spurious wakeup";
-    } else {
-        LOG(ERROR) << "Got more than one timeout!";
     }
 }
 
 bool TimeEventListener::schedule(uint64_t delay) {
-    const std::unique_lock lock(m_mutex);
+    return schedule(std::chrono::milliseconds(delay));
+}
 
-    if (m_fd < 0) {
-        LOG(WARNING) << "Cannot schedule event: socket already closed";
-        return false;
-    }
+bool TimeEventListener::schedule(std::chrono::nanoseconds delay) {
+    const auto nanos = static_cast<uint64_t>(
+        std::max<std::chrono::nanoseconds::rep>(delay.count(), 0));
 
-    bool is_scheduled = !m_queued_events.empty();
+    return internal_schedule(get_loop_time_ns() + nanos);
+}
 
-    auto start = get_current_time() + delay;
-    auto it = m_queued_events.insert(start);
+bool TimeEventListener::schedule_at(
+    std::chrono::steady_clock::time_point deadline) {
+    // The event loop's clock has the same epoch as the steady clock
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           deadline.time_since_epoch())
+                           .count();
 
-    if (it == m_queued_events.begin()) {
-        is_scheduled = false;
+    return internal_schedule(static_cast<uint64_t>(std::max<int64_t>(nanos, 0)));
+}
+
+bool TimeEventListener::internal_schedule(uint64_t deadline) {
+    const std::unique_lock lock(m_mutex);
+
+    if (m_closed) {
+        LOG(WARNING) << "Cannot schedule event: listener already closed";
+        return false;
     }
 
-    if (is_scheduled) {
+    m_queued_events.push_back(deadline);
+    std::push_heap(m_queued_events.begin(), m_queued_events.end(),
+                   std::greater<>());
+
+    if (m_queued_events.front() != deadline) {
         VLOG(2) << "Time event listener already enabled";
         return true;
     }
 
     VLOG(2) << "(Re-)enabling time event listener";
 
-    return internal_schedule(delay);
+    if (auto *wheel = get_timer_wheel()) {
+        wheel->schedule(*this, deadline);
+    }
+
+    return true;
 }
 
 bool TimeEventListener::unschedule() {
@@ -135,37 +165,27 @@ bool TimeEventListener::unschedule() {
     const bool has_events = !m_queued_events.empty();
     m_queued_events.clear();
 
-    return has_events;
-}
-
-bool TimeEventListener::internal_schedule(uint64_t delay) {
-    const auto flags = 0;
-    itimerspec new_value;
-    new_value.it_interval.tv_sec = 0;
-    new_value.it_interval.tv_nsec = 0;
-
-    if (delay == 0) {
-        // Setting the delay to 0 disarms the timer
-        // Instead we set it to 1ns as a workaround
-        new_value.it_value.tv_sec = 0;
-        new_value.it_value.tv_nsec = 1;
-    } else {
-        new_value.it_value.tv_sec =
-            static_cast<__syscall_slong_t>(delay) / 1000;
-        new_value.it_value.tv_nsec =
-            static_cast<__syscall_slong_t>(delay % 1000) * 1'000'000;
+    if (auto *wheel = get_timer_wheel()) {
+        wheel->cancel(*this);
     }
 
-    itimerspec old_value;
+    return has_events;
+}
 
-    auto res = timerfd_settime(m_fd, flags, &new_value, &old_value);
+TimerWheel *TimeEventListener::get_timer_wheel() const {
+    auto *el = event_loop();
+    return el != nullptr ? &el->get_timer_wheel(*this) : nullptr;
+}
 
-    if (res != 0) {
-        LOG(ERROR) << "Failed to set time event";
-        return false;
+uint64_t TimeEventListener::get_loop_time_ns() const {
+    if (auto *el = event_loop()) {
+        return el->get_time_ns();
     }
 
-    return true;
+    // Not registered (yet)
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
 }
 
 } // namespace yael
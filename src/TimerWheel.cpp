@@ -0,0 +1,324 @@
+#include "TimerWheel.h"
+
+#include <glog/logging.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ctime>
+
+namespace yael {
+
+namespace {
+
+uint64_t monotonic_time() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 +
+           static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/// Distance from slot start to the next occupied slot (in rotation order)
+uint64_t next_occupied(uint64_t occupied, uint64_t start) {
+    return static_cast<uint64_t>(
+        std::countr_zero(std::rotr(occupied, static_cast<int>(start))));
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(std::chrono::nanoseconds resolution)
+    : m_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      m_resolution(std::max<uint64_t>(resolution.count(), 1)),
+      m_now(monotonic_time() / m_resolution) {
+    if (m_fd < 0) {
+        LOG(FATAL) << "Failed to create timerfd: " << strerror(errno);
+    }
+}
+
+TimerWheel::~TimerWheel() { ::close(m_fd); }
+
+void TimerWheel::attach(std::shared_ptr<TimeEventListener> listener) {
+    const std::unique_lock lock(m_mutex);
+    auto &node = listener->m_timer;
+
+    node.attached_prev = nullptr;
+    node.attached_next = m_attached;
+
+    if (m_attached != nullptr) {
+        m_attached->attached_prev = &node;
+    }
+
+    m_attached = &node;
+    node.owner = std::move(listener);
+
+    m_num_attached++;
+}
+
+std::shared_ptr<TimeEventListener>
+TimerWheel::detach(TimeEventListener &listener) {
+    const std::unique_lock lock(m_mutex);
+    auto &node = listener.m_timer;
+
+    if (node.owner == nullptr) {
+        return nullptr;
+    }
+
+    if (node.level >= 0) {
+        unlink(node);
+    }
+
+    if (node.attached_prev != nullptr) {
+        node.attached_prev->attached_next = node.attached_next;
+    } else {
+        m_attached = node.attached_next;
+    }
+
+    if (node.attached_next != nullptr) {
+        node.attached_next->attached_prev = node.attached_prev;
+    }
+
+    node.attached_prev = node.attached_next = nullptr;
+    m_num_attached--;
+
+    return std::move(node.owner);
+}
+
+void TimerWheel::schedule(TimeEventListener &listener, uint64_t deadline) {
+    // Round up, so the timer never fires early
+    const auto expires = (deadline + m_resolution - 1) / m_resolution;
+
+    const std::unique_lock lock(m_mutex);
+    auto &node = listener.m_timer;
+
+    if (node.owner == nullptr || node.firing) {
+        return;
+    }
+
+    if (node.level >= 0) {
+        if (node.expires == expires) {
+            return;
+        }
+
+        unlink(node);
+    }
+
+    node.expires = expires;
+    link(node);
+
+    if (expires < m_armed) {
+        arm(expires);
+    }
+}
+
+void TimerWheel::cancel(TimeEventListener &listener) {
+    const std::unique_lock lock(m_mutex);
+    auto &node = listener.m_timer;
+
+    // The timerfd stays armed; firing without timers is harmless
+    if (node.level >= 0) {
+        unlink(node);
+    }
+}
+
+void TimerWheel::finish(TimeEventListener &listener) {
+    const std::unique_lock lock(m_mutex);
+    listener.m_timer.firing = false;
+}
+
+void TimerWheel::expire(uint64_t now, std::vector<EventListenerPtr> &expired) {
+    const std::unique_lock lock(m_mutex);
+
+    uint64_t count = 0;
+    now /= m_resolution;
+
+    if (::read(m_fd, &count, sizeof(count)) == sizeof(count) &&
+        m_armed != NO_TIMER) {
+        // The event loop's clock might be coarser than the timerfd
+        now = std::max(now, m_armed);
+    }
+
+    while (m_now <= now) {
+        const auto next = next_expiry();
+
+        if (next > m_now) {
+            // Skip ticks without any timers to expire or cascade
+            m_now = std::min(next, now + 1);
+            continue;
+        }
+
+        const auto index = m_now & SLOT_MASK;
+
+        if (index == 0) {
+            for (uint32_t level = 1; level < NUM_LEVELS; ++level) {
+                const auto slot = (m_now >> (LEVEL_BITS * level)) & SLOT_MASK;
+                cascade(level, slot);
+
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        while (auto *node = m_slots[0][index]) {
+            unlink(*node);
+
+            node->firing = true;
+            expired.push_back(node->owner);
+        }
+
+        m_now++;
+    }
+
+    // The timerfd is not armed anymore
+    m_armed = NO_TIMER;
+
+    const auto next = next_expiry();
+
+    if (next != NO_TIMER) {
+        arm(next);
+    }
+}
+
+std::vector<EventListenerPtr> TimerWheel::snapshot() {
+    std::vector<EventListenerPtr> result;
+    const std::unique_lock lock(m_mutex);
+
+    for (auto *node = m_attached; node != nullptr;
+         node = node->attached_next) {
+        result.push_back(node->owner);
+    }
+
+    return result;
+}
+
+void TimerWheel::link(node_t &node) {
+    uint32_t level = 0;
+    uint64_t slot = 0;
+
+    if (node.expires <= m_now) {
+        // Overdue; expires with the next tick
+        slot = m_now & SLOT_MASK;
+    } else {
+        const auto delta = std::min(node.expires - m_now, MAX_DELTA);
+
+        while (delta >> (LEVEL_BITS * (level + 1)) != 0) {
+            level++;
+        }
+
+        slot = ((m_now + delta) >> (LEVEL_BITS * level)) & SLOT_MASK;
+    }
+
+    auto &head = m_slots[level][slot];
+
+    node.prev = nullptr;
+    node.next = head;
+
+    if (head != nullptr) {
+        head->prev = &node;
+    }
+
+    head = &node;
+    m_occupied[level] |= uint64_t{1} << slot;
+
+    node.level = static_cast<int32_t>(level);
+    node.slot = static_cast<uint32_t>(slot);
+
+    m_num_timers++;
+}
+
+void TimerWheel::unlink(node_t &node) {
+    auto &head = m_slots[node.level][node.slot];
+
+    if (node.prev != nullptr) {
+        node.prev->next = node.next;
+    } else {
+        head = node.next;
+    }
+
+    if (node.next != nullptr) {
+        node.next->prev = node.prev;
+    }
+
+    if (head == nullptr) {
+        m_occupied[node.level] &= ~(uint64_t{1} << node.slot);
+    }
+
+    node.prev = node.next = nullptr;
+    node.level = -1;
+
+    m_num_timers--;
+}
+
+void TimerWheel::cascade(uint32_t level, uint64_t slot) {
+    auto *node = m_slots[level][slot];
+
+    if (node == nullptr) {
+        return;
+    }
+
+    m_slots[level][slot] = nullptr;
+    m_occupied[level] &= ~(uint64_t{1} << slot);
+
+    while (node != nullptr) {
+        auto *next = node->next;
+
+        m_num_timers--;
+        link(*node);
+
+        node = next;
+    }
+}
+
+uint64_t TimerWheel::next_expiry() const {
+    if (m_num_timers == 0) {
+        return NO_TIMER;
+    }
+
+    auto result = NO_TIMER;
+
+    if (m_occupied[0] != 0) {
+        // Exact for the lowest level
+        result = m_now + next_occupied(m_occupied[0], m_now & SLOT_MASK);
+    }
+
+    // Timers in higher levels expire no earlier than their slot cascades
+    for (uint32_t level = 1; level < NUM_LEVELS; ++level) {
+        if (m_occupied[level] == 0) {
+            continue;
+        }
+
+        const auto shift = LEVEL_BITS * level;
+        const auto granularity = uint64_t{1} << shift;
+        const auto start = (m_now + granularity - 1) & ~(granularity - 1);
+
+        const auto distance =
+            next_occupied(m_occupied[level], (start >> shift) & SLOT_MASK);
+        result = std::min(result, start + (distance << shift));
+    }
+
+    return result;
+}
+
+void TimerWheel::arm(uint64_t time) {
+    itimerspec value = {};
+
+    // Zero would disarm the timer
+    time = std::max<uint64_t>(time, 1);
+
+    const auto nanos = time * m_resolution;
+
+    value.it_value.tv_sec = static_cast<time_t>(nanos / 1'000'000'000);
+    value.it_value.tv_nsec = static_cast<long>(nanos % 1'000'000'000);
+
+    if (timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &value, nullptr) != 0) {
+        LOG(ERROR) << "Failed to set timer: " << strerror(errno);
+        return;
+    }
+
+    m_armed = time;
+}
+
+} // namespace yael
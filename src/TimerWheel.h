@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "yael/TimeEventListener.h"
+
+namespace yael {
+
+/**
+ * Hierarchical timing wheel that drives all time event listeners of a shard
+ *
+ * Every listener has (at most) one timer in the wheel, for its earliest
+ * pending event. Inserting and cancelling timers takes constant time and
+ * does not allocate. Timers that are further out are kept in coarser levels
+ * and cascade down as their time approaches.
+ *
+ * The wheel arms a single timerfd (CLOCK_MONOTONIC) with the absolute time
+ * it has to be advanced at next. Deadlines are in nanoseconds of the event
+ * loop's clock (see EventLoop::get_time_ns) and are rounded up to the next
+ * tick, whose length is set by the resolution.
+ */
+class TimerWheel {
+  public:
+    using node_t = TimeEventListener::timer_node_t;
+
+    static constexpr uint64_t NO_TIMER = std::numeric_limits<uint64_t>::max();
+
+    explicit TimerWheel(std::chrono::nanoseconds resolution);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &other) = delete;
+
+    /// The timerfd to register with the shard's poller
+    [[nodiscard]]
+    int32_t get_fileno() const {
+        return m_fd;
+    }
+
+    /// Keep the listener alive until it is detached
+    void attach(std::shared_ptr<TimeEventListener> listener);
+
+    /**
+     * Cancel the listener's timer and release it
+     * @return the reference the wheel held (nullptr if it was not attached),
+     *         so it can be dropped without holding any locks
+     */
+    std::shared_ptr<TimeEventListener> detach(TimeEventListener &listener);
+
+    /**
+     * Set the listener's timer (or move it, if it is set already)
+     * Does nothing while the listener is firing (see finish)
+     */
+    void schedule(TimeEventListener &listener, uint64_t deadline);
+
+    void cancel(TimeEventListener &listener);
+
+    /**
+     * The timerfd fired: advance the wheel to now (in nanoseconds)
+     *
+     * Listeners whose timer expired are appended to expired. Their timer can
+     * only be set again once they are done firing.
+     */
+    void expire(uint64_t now, std::vector<EventListenerPtr> &expired);
+
+    /// The listener handled its events
+    void finish(TimeEventListener &listener);
+
+    /// When the listener's timer expired (only valid while it is firing)
+    [[nodiscard]]
+    uint64_t get_expiry(const TimeEventListener &listener) const {
+        return listener.m_timer.expires * m_resolution;
+    }
+
+    /// Get references to all attached listeners
+    std::vector<EventListenerPtr> snapshot();
+
+    /// The number of attached listeners
+    [[nodiscard]]
+    size_t size() const {
+        return m_num_attached;
+    }
+
+  private:
+    static constexpr uint32_t LEVEL_BITS = 6;
+    static constexpr uint32_t NUM_SLOTS = 1U << LEVEL_BITS;
+    static constexpr uint64_t SLOT_MASK = NUM_SLOTS - 1;
+    static constexpr uint32_t NUM_LEVELS = 6;
+
+    /// Timers that are further out are kept in the last level and cascade
+    /// down multiple times
+    static constexpr uint64_t MAX_DELTA =
+        (uint64_t{1} << (LEVEL_BITS * NUM_LEVELS)) - 1;
+
+    /// Add the node to the slot matching its expiry (must hold m_mutex)
+    void link(node_t &node);
+
+    void unlink(node_t &node);
+
+    /// Move all timers of a slot to lower levels
+    void cascade(uint32_t level, uint64_t slot);
+
+    /// The earliest time the wheel might have to be advanced at
+    [[nodiscard]]
+    uint64_t next_expiry() const;
+
+    /// Set the timerfd to the specified (absolute) time
+    void arm(uint64_t time);
+
+    const int32_t m_fd;
+
+    /// Length of a tick in nanoseconds
+    const uint64_t m_resolution;
+
+    std::mutex m_mutex;
+
+    /// The next tick that has not been processed yet
+    uint64_t m_now;
+
+    /// When the timerfd will fire (if armed)
+    uint64_t m_armed = NO_TIMER;
+
+    std::array<std::array<node_t *, NUM_SLOTS>, NUM_LEVELS> m_slots = {};
+
+    /// Which slots are not empty (one bit per slot)
+    std::array<uint64_t, NUM_LEVELS> m_occupied = {};
+
+    size_t m_num_timers = 0;
+
+    node_t *m_attached = nullptr;
+    std::atomic<size_t> m_num_attached = 0;
+};
+
+} // namespace yael
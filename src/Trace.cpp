@@ -0,0 +1,275 @@
+#include "yael/Trace.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace yael::trace {
+
+namespace detail {
+
+std::atomic<bool> enabled = false;
+
+uint64_t now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace detail
+
+namespace {
+
+struct span_t {
+    const char *name;
+    int32_t fileno;
+    uint64_t start;
+    uint64_t end;
+};
+
+/**
+ * Spans recorded by a single thread
+ *
+ * Only the owning thread writes. Once the ring is full, the oldest spans are
+ * overwritten. Readers detect entries that were overwritten while they were
+ * copying them by checking the head again afterwards.
+ */
+class ThreadRing {
+  public:
+    explicit ThreadRing(size_t size)
+        : m_mask(size - 1), m_slots(new slot_t[size]),
+          m_thread_id(current_thread_id()) {}
+
+    /**
+     * Hand the ring of a terminated thread to the calling thread
+     * Spans of the previous owner are dropped, as they would be attributed to
+     * the wrong thread otherwise.
+     */
+    void reuse() noexcept {
+        m_first.store(m_head.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+        m_thread_id.store(current_thread_id(), std::memory_order_release);
+    }
+
+    void record(const span_t &span) noexcept {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        auto &slot = m_slots[head & m_mask];
+
+        slot.name.store(span.name, std::memory_order_relaxed);
+        slot.fileno.store(span.fileno, std::memory_order_relaxed);
+        slot.start.store(span.start, std::memory_order_relaxed);
+        slot.end.store(span.end, std::memory_order_relaxed);
+
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    std::vector<span_t> read() const {
+        const auto size = m_mask + 1;
+        const auto head = m_head.load(std::memory_order_acquire);
+        const auto first = std::max(head > size ? head - size : 0,
+                                    m_first.load(std::memory_order_relaxed));
+
+        std::vector<span_t> result;
+        result.reserve(head - first);
+
+        for (auto idx = first; idx < head; ++idx) {
+            auto &slot = m_slots[idx & m_mask];
+            span_t span;
+
+            span.name = slot.name.load(std::memory_order_relaxed);
+            span.fileno = slot.fileno.load(std::memory_order_relaxed);
+            span.start = slot.start.load(std::memory_order_relaxed);
+            span.end = slot.end.load(std::memory_order_relaxed);
+
+            result.push_back(span);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Drop everything the writer might have overwritten in the meantime
+        const auto new_head = m_head.load(std::memory_order_relaxed);
+        const auto valid_first = new_head > size ? new_head - size : 0;
+
+        if (valid_first > first) {
+            const auto num_stale = std::min<size_t>(valid_first - first,
+                                                    result.size());
+            result.erase(result.begin(), result.begin() + num_stale);
+        }
+
+        return result;
+    }
+
+    [[nodiscard]]
+    int32_t thread_id() const {
+        return m_thread_id.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        return m_mask + 1;
+    }
+
+  private:
+    static int32_t current_thread_id() noexcept {
+        return static_cast<int32_t>(syscall(SYS_gettid));
+    }
+
+    struct slot_t {
+        std::atomic<const char *> name = nullptr;
+        std::atomic<int32_t> fileno = -1;
+        std::atomic<uint64_t> start = 0;
+        std::atomic<uint64_t> end = 0;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<slot_t[]> m_slots;
+    std::atomic<int32_t> m_thread_id;
+
+    std::atomic<size_t> m_head = 0;
+
+    /// Spans before this index belong to a previous owner (see reuse)
+    std::atomic<size_t> m_first = 0;
+};
+
+/**
+ * Rings of all threads, including those that terminated already
+ * The rings of terminated threads are reused by new threads, so the registry
+ * does not grow with every short-lived thread.
+ */
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadRing>> registry;
+std::vector<ThreadRing *> free_rings;
+size_t ring_size = DEFAULT_EVENTS_PER_THREAD;
+
+/// Puts the thread's ring on the free list once the thread terminates
+struct ring_owner_t {
+    ThreadRing *ring = nullptr;
+
+    ~ring_owner_t() {
+        if (ring != nullptr) {
+            const std::unique_lock lock(registry_mutex);
+            free_rings.push_back(ring);
+        }
+    }
+};
+
+thread_local ring_owner_t thread_ring;
+
+/// Get a ring of a terminated thread (must hold registry_mutex)
+ThreadRing *take_free_ring() {
+    while (!free_rings.empty()) {
+        auto *ring = free_rings.back();
+        free_rings.pop_back();
+
+        if (ring->size() == ring_size) {
+            ring->reuse();
+            return ring;
+        }
+
+        // The ring size changed since (see enable)
+        std::erase_if(registry, [ring](const auto &entry) {
+            return entry.get() == ring;
+        });
+    }
+
+    return nullptr;
+}
+
+ThreadRing &get_thread_ring() {
+    if (thread_ring.ring == nullptr) {
+        const std::unique_lock lock(registry_mutex);
+
+        thread_ring.ring = take_free_ring();
+
+        if (thread_ring.ring == nullptr) {
+            auto ring = std::make_shared<ThreadRing>(ring_size);
+            thread_ring.ring = ring.get();
+            registry.emplace_back(std::move(ring));
+        }
+    }
+
+    return *thread_ring.ring;
+}
+
+/// Chrome expects microseconds; print them without losing precision
+void write_micros(std::ostream &out, uint64_t nanos) {
+    const auto fill = out.fill('0');
+    out << nanos / 1000 << "." << std::setw(3) << nanos % 1000;
+    out.fill(fill);
+}
+
+size_t round_up_to_power_of_two(size_t value) {
+    size_t result = 1;
+
+    while (result < value) {
+        result <<= 1U;
+    }
+
+    return result;
+}
+
+} // namespace
+
+void detail::record(const char *name, int32_t fileno, uint64_t start,
+                    uint64_t end) noexcept {
+    get_thread_ring().record(span_t{name, fileno, start, end});
+}
+
+void enable(size_t events_per_thread) {
+    {
+        const std::unique_lock lock(registry_mutex);
+        ring_size =
+            round_up_to_power_of_two(std::max<size_t>(events_per_thread, 2));
+    }
+
+    detail::enabled = true;
+}
+
+void disable() noexcept { detail::enabled = false; }
+
+void write_chrome_trace(std::ostream &out) {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+
+    {
+        const std::unique_lock lock(registry_mutex);
+        rings = registry;
+    }
+
+    const auto pid = getpid();
+    bool first = true;
+
+    out << "{\"traceEvents\":[";
+
+    for (auto &ring : rings) {
+        for (auto &span : ring->read()) {
+            if (!first) {
+                out << ",";
+            }
+
+            first = false;
+
+            out << "\n{\"name\":\"" << span.name
+                << "\",\"cat\":\"yael\",\"ph\":\"X\",\"ts\":";
+            write_micros(out, span.start);
+            out << ",\"dur\":";
+            write_micros(out, span.end - span.start);
+            out << ",\"pid\":" << pid << ",\"tid\":" << ring->thread_id();
+
+            if (span.fileno >= 0) {
+                out << ",\"args\":{\"fd\":" << span.fileno << "}";
+            }
+
+            out << "}";
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+} // namespace yael::trace
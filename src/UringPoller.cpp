@@ -0,0 +1,486 @@
+#include <glog/logging.h>
+
+#include "Poller.h"
+
+#if __has_include(<linux/io_uring.h>)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace yael {
+
+namespace {
+
+int io_uring_setup(uint32_t num_entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, num_entries, params));
+}
+
+int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                   uint32_t flags, void *arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, arg, arg_size));
+}
+
+/// Completions of remove requests carry this tag and are ignored
+constexpr uint64_t REMOVE_TAG = ~0ULL;
+
+/// Flags that only make sense to epoll
+constexpr uint32_t EPOLL_ONLY_FLAGS = EPOLLONESHOT | EPOLLET;
+
+} // namespace
+
+/**
+ * Poller built on io_uring poll requests
+ *
+ * Filenos registered with EPOLLONESHOT use single-shot polls, so they are
+ * disarmed once they fire, just like with epoll. Everything else uses
+ * multishot polls.
+ *
+ * Only one thread may call wait(). Re-arming a fileno from that thread does
+ * not require a syscall; the request is submitted with the next wait().
+ */
+class UringPoller : public Poller {
+  public:
+    UringPoller() = default;
+    ~UringPoller() override;
+
+    bool init(uint32_t num_entries);
+
+    bool add(int32_t fileno, uint32_t flags) override;
+
+    bool modify(int32_t fileno, uint32_t flags) override;
+
+    bool remove(int32_t fileno) override;
+
+    int wait(epoll_event *events, int max_events, int timeout) override;
+
+    [[nodiscard]]
+    bool is_thread_safe() const override {
+        return false;
+    }
+
+  private:
+    struct registration_t {
+        uint64_t user_data;
+        uint32_t flags;
+        bool armed;
+    };
+
+    /// @note the following functions need to hold m_mutex
+    void push_sqe(const io_uring_sqe &entry);
+    void queue_poll(int32_t fileno, registration_t &registration);
+    void queue_remove(const registration_t &registration);
+    uint32_t num_pending() const;
+    int submit();
+
+    /// Submit right away unless called by the polling thread
+    void submit_if_foreign();
+
+    void handle_completion(const io_uring_cqe &cqe, epoll_event *events,
+                           int &num_events);
+
+    int m_ring_fd = -1;
+
+    void *m_sq_ring = nullptr;
+    size_t m_sq_ring_size = 0;
+    void *m_cq_ring = nullptr;
+    size_t m_cq_ring_size = 0;
+    io_uring_sqe *m_sqes = nullptr;
+    size_t m_sqes_size = 0;
+
+    uint32_t *m_sq_head = nullptr;
+    uint32_t *m_sq_tail = nullptr;
+    uint32_t m_sq_mask = 0;
+    uint32_t m_sq_entries = 0;
+    uint32_t *m_sq_array = nullptr;
+
+    uint32_t *m_cq_head = nullptr;
+    uint32_t *m_cq_tail = nullptr;
+    uint32_t m_cq_mask = 0;
+    io_uring_cqe *m_cqes = nullptr;
+
+    bool m_multishot_supported = true;
+
+    std::atomic<std::thread::id> m_owner;
+
+    /// Protects the submission queue and the registrations
+    std::mutex m_mutex;
+    std::unordered_map<int32_t, registration_t> m_registrations;
+    uint32_t m_generation = 0;
+};
+
+UringPoller::~UringPoller() {
+    if (m_sqes != nullptr) {
+        munmap(m_sqes, m_sqes_size);
+    }
+
+    if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring) {
+        munmap(m_cq_ring, m_cq_ring_size);
+    }
+
+    if (m_sq_ring != nullptr) {
+        munmap(m_sq_ring, m_sq_ring_size);
+    }
+
+    if (m_ring_fd >= 0) {
+        ::close(m_ring_fd);
+    }
+}
+
+bool UringPoller::init(uint32_t num_entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    m_ring_fd = io_uring_setup(num_entries, &params);
+
+    if (m_ring_fd < 0) {
+        VLOG(1) << "io_uring_setup() failed: " << strerror(errno);
+        return false;
+    }
+
+    // Needed for waiting with a timeout
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0U) {
+        VLOG(1) << "Kernel does not support IORING_FEAT_EXT_ARG";
+        return false;
+    }
+
+    m_sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    m_cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0U;
+
+    if (single_mmap) {
+        m_sq_ring_size = m_cq_ring_size =
+            std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+
+    m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+
+    if (m_sq_ring == MAP_FAILED) {
+        m_sq_ring = nullptr;
+        return false;
+    }
+
+    if (single_mmap) {
+        m_cq_ring = m_sq_ring;
+    } else {
+        m_cq_ring =
+            mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+
+        if (m_cq_ring == MAP_FAILED) {
+            m_cq_ring = nullptr;
+            return false;
+        }
+    }
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    auto *sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+
+    m_sqes = reinterpret_cast<io_uring_sqe *>(sqes);
+
+    auto *sq_base = reinterpret_cast<uint8_t *>(m_sq_ring);
+    m_sq_head = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<uint32_t *>(sq_base + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sq_array = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.array);
+
+    auto *cq_base = reinterpret_cast<uint8_t *>(m_cq_ring);
+    m_cq_head = reinterpret_cast<uint32_t *>(cq_base + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<uint32_t *>(cq_base + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<uint32_t *>(cq_base + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe *>(cq_base + params.cq_off.cqes);
+
+    return true;
+}
+
+uint32_t UringPoller::num_pending() const {
+    return *m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+}
+
+int UringPoller::submit() {
+    auto pending = num_pending();
+
+    if (pending == 0) {
+        return 0;
+    }
+
+    return io_uring_enter(m_ring_fd, pending, 0, 0, nullptr, 0);
+}
+
+void UringPoller::push_sqe(const io_uring_sqe &entry) {
+    if (num_pending() >= m_sq_entries) {
+        // Submission queue is full; flush it
+        if (submit() < 0) {
+            LOG(FATAL) << "io_uring_enter() failed: " << strerror(errno);
+        }
+    }
+
+    auto tail = *m_sq_tail;
+    auto idx = tail & m_sq_mask;
+
+    m_sqes[idx] = entry;
+    m_sq_array[idx] = idx;
+
+    // Publish the entry only after it has been written
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void UringPoller::queue_poll(int32_t fileno, registration_t &registration) {
+    // Lower half identifies the fileno, upper half stale completions
+    registration.user_data = (static_cast<uint64_t>(++m_generation) << 32U) |
+                             static_cast<uint32_t>(fileno);
+    registration.armed = true;
+
+    const bool multishot =
+        (registration.flags & EPOLLONESHOT) == 0U && m_multishot_supported;
+
+    io_uring_sqe entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_POLL_ADD;
+    entry.fd = fileno;
+    entry.poll32_events = registration.flags & ~EPOLL_ONLY_FLAGS;
+    entry.user_data = registration.user_data;
+
+    if (multishot) {
+        entry.len = IORING_POLL_ADD_MULTI;
+    }
+
+    push_sqe(entry);
+}
+
+void UringPoller::queue_remove(const registration_t &registration) {
+    io_uring_sqe entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_POLL_REMOVE;
+    entry.addr = registration.user_data;
+    entry.user_data = REMOVE_TAG;
+
+    push_sqe(entry);
+}
+
+void UringPoller::submit_if_foreign() {
+    if (m_owner.load() == std::this_thread::get_id()) {
+        // will be submitted with the next call to wait()
+        return;
+    }
+
+    if (submit() < 0) {
+        LOG(ERROR) << "io_uring_enter() failed: " << strerror(errno);
+    }
+}
+
+bool UringPoller::add(int32_t fileno, uint32_t flags) {
+    const std::unique_lock lock(m_mutex);
+
+    auto [it, inserted] =
+        m_registrations.emplace(fileno, registration_t{0, flags, false});
+
+    if (!inserted) {
+        errno = EEXIST;
+        return false;
+    }
+
+    queue_poll(fileno, it->second);
+    submit_if_foreign();
+
+    return true;
+}
+
+bool UringPoller::modify(int32_t fileno, uint32_t flags) {
+    const std::unique_lock lock(m_mutex);
+
+    auto it = m_registrations.find(fileno);
+
+    if (it == m_registrations.end()) {
+        errno = ENOENT;
+        return false;
+    }
+
+    auto &registration = it->second;
+
+    if (registration.armed) {
+        queue_remove(registration);
+    }
+
+    registration.flags = flags;
+    queue_poll(fileno, registration);
+    submit_if_foreign();
+
+    return true;
+}
+
+bool UringPoller::remove(int32_t fileno) {
+    const std::unique_lock lock(m_mutex);
+
+    auto it = m_registrations.find(fileno);
+
+    if (it == m_registrations.end()) {
+        errno = ENOENT;
+        return false;
+    }
+
+    if (it->second.armed) {
+        queue_remove(it->second);
+    }
+
+    m_registrations.erase(it);
+    submit_if_foreign();
+
+    return true;
+}
+
+void UringPoller::handle_completion(const io_uring_cqe &cqe,
+                                    epoll_event *events, int &num_events) {
+    if (cqe.user_data == REMOVE_TAG) {
+        return;
+    }
+
+    const auto fileno = static_cast<int32_t>(cqe.user_data & 0xFFFFFFFFU);
+    auto it = m_registrations.find(fileno);
+
+    if (it == m_registrations.end() || it->second.user_data != cqe.user_data) {
+        // Completion of a poll request that was removed or replaced
+        return;
+    }
+
+    auto &registration = it->second;
+    const bool persistent = (registration.flags & EPOLLONESHOT) == 0U;
+    const bool has_more = (cqe.flags & IORING_CQE_F_MORE) != 0U;
+
+    if (!has_more) {
+        registration.armed = false;
+    }
+
+    uint32_t flags = 0;
+
+    if (cqe.res == -EINVAL && persistent && m_multishot_supported) {
+        VLOG(1) << "Multishot polls not supported. Will re-arm manually.";
+        m_multishot_supported = false;
+        queue_poll(fileno, registration);
+        return;
+    } else if (cqe.res == -ECANCELED) {
+        // e.g., the kernel dropped a multishot request
+        flags = 0;
+    } else if (cqe.res < 0) {
+        flags = EPOLLERR;
+    } else {
+        flags = static_cast<uint32_t>(cqe.res);
+    }
+
+    if (persistent && !registration.armed) {
+        queue_poll(fileno, registration);
+    }
+
+    if (flags != 0) {
+        auto &ev = events[num_events];
+        ev.events = flags;
+        ev.data.fd = fileno;
+        num_events++;
+    }
+}
+
+int UringPoller::wait(epoll_event *events, int max_events, int timeout) {
+    m_owner = std::this_thread::get_id();
+
+    uint32_t to_submit = 0;
+
+    {
+        const std::unique_lock lock(m_mutex);
+        to_submit = num_pending();
+    }
+
+    auto cq_head = *m_cq_head;
+    const bool has_completions =
+        __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE) != cq_head;
+
+    int res = 0;
+
+    if (has_completions || timeout == 0) {
+        if (to_submit > 0) {
+            res = io_uring_enter(m_ring_fd, to_submit, 0, 0, nullptr, 0);
+        }
+    } else if (timeout < 0) {
+        // Submit all re-arms and wait using a single syscall
+        res = io_uring_enter(m_ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS,
+                             nullptr, 0);
+    } else {
+        __kernel_timespec ts;
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = static_cast<int64_t>(timeout % 1000) * 1'000'000;
+
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+        res = io_uring_enter(m_ring_fd, to_submit, 1,
+                             IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                             &arg, sizeof(arg));
+
+        if (res < 0 && errno == ETIME) {
+            res = 0;
+        }
+    }
+
+    if (res < 0) {
+        return -1;
+    }
+
+    int num_events = 0;
+    const std::unique_lock lock(m_mutex);
+
+    cq_head = *m_cq_head;
+    const auto cq_tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+
+    while (cq_head != cq_tail && num_events < max_events) {
+        handle_completion(m_cqes[cq_head & m_cq_mask], events, num_events);
+        cq_head++;
+    }
+
+    __atomic_store_n(m_cq_head, cq_head, __ATOMIC_RELEASE);
+    return num_events;
+}
+
+std::unique_ptr<Poller> make_uring_poller(uint32_t num_entries) {
+    auto poller = std::make_unique<UringPoller>();
+
+    if (!poller->init(num_entries)) {
+        return nullptr;
+    }
+
+    return poller;
+}
+
+} // namespace yael
+
+#else
+
+namespace yael {
+
+std::unique_ptr<Poller> make_uring_poller(uint32_t num_entries) {
+    (void)num_entries;
+    VLOG(1) << "Built without io_uring support";
+    return nullptr;
+}
+
+} // namespace yael
+
+#endif
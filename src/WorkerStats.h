@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "yael/Stats.h"
+
+namespace yael {
+
+/**
+ * Statistics of one worker thread
+ * Only the worker updates them, but they can be read by any thread.
+ */
+class WorkerStats {
+  public:
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void add_wakeup() { increment(m_wakeups, 1); }
+
+    void add_events(uint64_t count) { increment(m_events, count); }
+
+    void add_task() { increment(m_tasks, 1); }
+
+    void add_busy_poll_hit() { increment(m_busy_poll_hits, 1); }
+
+    [[nodiscard]]
+    worker_stats_t snapshot() const {
+        worker_stats_t result;
+        result.wakeups = m_wakeups.load(std::memory_order_relaxed);
+        result.events = m_events.load(std::memory_order_relaxed);
+        result.tasks = m_tasks.load(std::memory_order_relaxed);
+        result.busy_poll_hits =
+            m_busy_poll_hits.load(std::memory_order_relaxed);
+        result.handler_time = handler_time;
+        result.queue_delay = queue_delay;
+
+        return result;
+    }
+
+    Histogram handler_time;
+    Histogram queue_delay;
+
+  private:
+    static void increment(std::atomic<uint64_t> &counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> m_wakeups = 0;
+    std::atomic<uint64_t> m_events = 0;
+    std::atomic<uint64_t> m_tasks = 0;
+    std::atomic<uint64_t> m_busy_poll_hits = 0;
+};
+
+} // namespace yael
@@ -0,0 +1,221 @@
+#include "yael/network/Resolver.h"
+
+#include <glog/logging.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <algorithm>
+
+#include "../Signals.h"
+#include "yael/EventLoop.h"
+
+namespace yael::network {
+
+namespace {
+
+constexpr size_t MIN_PRUNE_THRESHOLD = 1024;
+
+/// Cache keys (and queue entries) are the host name followed by the address
+/// family
+std::string make_key(const std::string &host, bool IPv6) {
+    return host + (IPv6 ? "/6" : "/4");
+}
+
+/**
+ * Resolve the host with getaddrinfo (blocking)
+ * @param cacheable set to false if the lookup failed for a temporary reason
+ */
+std::optional<Address> query(const std::string &host, bool IPv6,
+                             bool &cacheable) {
+    addrinfo hints = {};
+    hints.ai_family = IPv6 ? AF_INET6 : AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *result = nullptr;
+    const auto error = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+
+    if (error != 0) {
+        VLOG(1) << "Failed to resolve " << host << ": " << gai_strerror(error);
+
+        cacheable =
+            error != EAI_AGAIN && error != EAI_SYSTEM && error != EAI_MEMORY;
+        return {};
+    }
+
+    std::optional<Address> address;
+
+    if (IPv6) {
+        address = Address(*reinterpret_cast<sockaddr_in6 *>(result->ai_addr));
+    } else {
+        address = Address(*reinterpret_cast<sockaddr_in *>(result->ai_addr));
+    }
+
+    freeaddrinfo(result);
+
+    cacheable = true;
+    return address;
+}
+
+} // namespace
+
+Resolver::Resolver(EventLoop &event_loop, const resolver_config_t &config)
+    : m_event_loop(event_loop), m_config(config),
+      m_prune_threshold(MIN_PRUNE_THRESHOLD) {
+    // Leave asynchronous signals to the application.
+    // The threads inherit the mask, so they are blocked from the start
+    sigset_t previous;
+    block_async_signals(previous);
+
+    for (uint32_t i = 0; i < std::max<uint32_t>(config.num_threads, 1); ++i) {
+        m_threads.emplace_back(&Resolver::thread_loop, this);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+Resolver::~Resolver() {
+    {
+        const std::unique_lock lock(m_mutex);
+        m_stopped = true;
+    }
+
+    m_cond.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void Resolver::resolve(const std::string &host, uint16_t port_number,
+                       bool IPv6, Callback callback) {
+    const auto key = make_key(host, IPv6);
+    std::unique_lock lock(m_mutex);
+
+    auto it = m_cache.find(key);
+
+    if (it != m_cache.end()) {
+        if (it->second.expires > std::chrono::steady_clock::now()) {
+            auto address = it->second.address;
+            lock.unlock();
+
+            std::vector<waiter_t> waiters;
+            waiters.push_back({port_number, std::move(callback)});
+            deliver(std::move(waiters), address);
+            return;
+        }
+
+        m_cache.erase(it);
+    }
+
+    auto &waiters = m_pending[key];
+    waiters.push_back({port_number, std::move(callback)});
+
+    // Otherwise, the same lookup is queued or running already
+    if (waiters.size() == 1) {
+        m_queue.push_back(key);
+        m_cond.notify_one();
+    }
+}
+
+std::optional<Address> Resolver::lookup(const std::string &host,
+                                        uint16_t port_number, bool IPv6) {
+    const std::unique_lock lock(m_mutex);
+    auto it = m_cache.find(make_key(host, IPv6));
+
+    if (it == m_cache.end() ||
+        it->second.expires <= std::chrono::steady_clock::now() ||
+        !it->second.address) {
+        return {};
+    }
+
+    auto address = *it->second.address;
+    address.PortNumber = port_number;
+    return address;
+}
+
+void Resolver::clear_cache() {
+    const std::unique_lock lock(m_mutex);
+    m_cache.clear();
+}
+
+void Resolver::thread_loop() {
+    std::unique_lock lock(m_mutex);
+
+    while (true) {
+        m_cond.wait(lock, [&]() { return m_stopped || !m_queue.empty(); });
+
+        if (m_stopped) {
+            return;
+        }
+
+        auto key = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        lock.unlock();
+
+        const auto host = key.substr(0, key.size() - 2);
+        const bool IPv6 = key.back() == '6';
+
+        bool cacheable = false;
+        const auto address = query(host, IPv6, cacheable);
+
+        complete(key, address, cacheable);
+
+        lock.lock();
+    }
+}
+
+void Resolver::complete(const std::string &key,
+                        const std::optional<Address> &address, bool cache) {
+    std::unique_lock lock(m_mutex);
+
+    if (cache) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto ttl =
+            address ? m_config.positive_ttl : m_config.negative_ttl;
+
+        if (m_cache.size() >= m_prune_threshold) {
+            std::erase_if(m_cache, [&](const auto &entry) {
+                return entry.second.expires <= now;
+            });
+
+            m_prune_threshold =
+                std::max(MIN_PRUNE_THRESHOLD, 2 * m_cache.size());
+        }
+
+        if (ttl.count() > 0) {
+            m_cache[key] = entry_t{address, now + ttl};
+        }
+    }
+
+    auto node = m_pending.extract(key);
+    lock.unlock();
+
+    if (node) {
+        deliver(std::move(node.mapped()), address);
+    }
+}
+
+void Resolver::deliver(std::vector<waiter_t> &&waiters,
+                       const std::optional<Address> &address) {
+    for (auto &waiter : waiters) {
+        auto result = address;
+
+        if (result) {
+            result->PortNumber = waiter.port_number;
+        }
+
+        const bool posted = m_event_loop.post(
+            [callback = std::move(waiter.callback), result]() {
+                callback(result);
+            });
+
+        if (!posted) {
+            VLOG(1) << "Dropping lookup result: event loop is shutting down";
+        }
+    }
+}
+
+} // namespace yael::network
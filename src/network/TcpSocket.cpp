@@ -18,6 +18,7 @@
 
 #include "DatagramMessageSlicer.h"
 #include "StreamMessageSlicer.h"
+#include "yael/Trace.h"
 
 using namespace std;
 
@@ -25,6 +26,11 @@ namespace yael::network {
 
 constexpr int TRUE_FLAG = 1;
 
+// Only defined by recent kernel headers
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
 TcpSocket::TcpSocket(MessageMode mode, size_t max_send_queue_size)
     : m_port(0), m_is_ipv6(false), m_fd(-1),
       m_max_send_queue_size(max_send_queue_size) {
@@ -103,6 +109,12 @@ bool TcpSocket::bind_socket(const Address &address) {
     // Reuse address so we can quickly recover from crashes
     ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &TRUE_FLAG, sizeof(TRUE_FLAG));
 
+    if (m_reuse_port && ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT,
+                                     &TRUE_FLAG, sizeof(TRUE_FLAG)) != 0) {
+        LOG(ERROR) << "Failed to set SO_REUSEPORT: " << strerror(errno);
+        return false;
+    }
+
     if (m_is_ipv6) {
         sockaddr_in6 sock_addr;
         address.get_sock_address6(sock_addr);
@@ -125,6 +137,38 @@ bool TcpSocket::bind_socket(const Address &address) {
     return true;
 }
 
+void TcpSocket::set_reuse_port(bool enabled) {
+    if (is_valid()) {
+        throw socket_error("Cannot change SO_REUSEPORT of an existing socket");
+    }
+
+    m_reuse_port = enabled;
+}
+
+bool TcpSocket::set_busy_poll(uint32_t usecs) {
+    if (!is_valid()) {
+        throw socket_error("Cannot enable busy polling on invalid socket");
+    }
+
+    const int value = static_cast<int>(usecs);
+
+    if (::setsockopt(m_fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) !=
+        0) {
+        LOG(WARNING) << "Failed to set SO_BUSY_POLL: " << strerror(errno);
+        return false;
+    }
+
+    const int prefer = usecs > 0 ? 1 : 0;
+
+    // Not supported by older kernels; busy polling still works without it
+    if (::setsockopt(m_fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer,
+                     sizeof(prefer)) != 0) {
+        VLOG(1) << "Failed to set SO_PREFER_BUSY_POLL: " << strerror(errno);
+    }
+
+    return true;
+}
+
 bool TcpSocket::listen(const Address &address, uint32_t backlog) {
     if (!bind_socket(address)) {
         throw socket_error("Failed to bind socket!");
@@ -150,7 +194,20 @@ uint16_t TcpSocket::port() const {
     return m_port;
 }
 
-bool TcpSocket::connect(const Address &address, const std::string &name) {
+void TcpSocket::set_blocking(bool blocking) {
+    uint32_t flags = fcntl(m_fd, F_GETFL, 0);
+
+    if (blocking) {
+        flags = flags & ~O_NONBLOCK;
+    } else {
+        flags = flags | O_NONBLOCK;
+    }
+
+    fcntl(m_fd, F_SETFL, flags);
+}
+
+int TcpSocket::internal_connect(const Address &address,
+                                const std::string &name, bool blocking) {
     if (address.PortNumber == 0) {
         throw std::invalid_argument("Need to specify a port number");
     }
@@ -168,34 +225,94 @@ bool TcpSocket::connect(const Address &address, const std::string &name) {
         }
     }
 
-    // Set it blocking just for connect
-    uint32_t flags = fcntl(m_fd, F_GETFL, 0);
-    flags = flags & ~O_NONBLOCK;
-    fcntl(m_fd, F_SETFL, flags);
+    set_blocking(blocking);
 
     if (m_is_ipv6) {
         sockaddr_in6 sock_addr;
         address.get_sock_address6(sock_addr);
 
-        if (::connect(m_fd, reinterpret_cast<const sockaddr *>(&sock_addr),
-                      sizeof(sock_addr)) != 0) {
-            close();
-            return false;
-        }
+        return ::connect(m_fd, reinterpret_cast<const sockaddr *>(&sock_addr),
+                         sizeof(sock_addr));
     } else {
         sockaddr_in sock_addr;
         address.get_sock_address(sock_addr);
 
-        if (::connect(m_fd, reinterpret_cast<const sockaddr *>(&sock_addr),
-                      sizeof(sock_addr)) != 0) {
-            close();
+        return ::connect(m_fd, reinterpret_cast<const sockaddr *>(&sock_addr),
+                         sizeof(sock_addr));
+    }
+}
+
+bool TcpSocket::connect(const Address &address, const std::string &name) {
+    // Set it blocking just for connect
+    if (internal_connect(address, name, true) != 0) {
+        close();
+        return false;
+    }
+
+    set_blocking(false);
+
+    calculate_remote_address();
+    update_port_number();
+
+    m_state = State::Connected;
+    return true;
+}
+
+bool TcpSocket::connect_async(const Address &address,
+                              const std::string &name) {
+    if (internal_connect(address, name, false) == 0) {
+        // Can happen for local connections.
+        // Subclasses (e.g. TlsSocket) finish connecting on their own
+        m_state = State::Connecting;
+
+        try {
+            TcpSocket::finish_connect();
+        } catch (const socket_error &e) {
+            // The socket has been closed already
+            VLOG(1) << e.what();
             return false;
         }
+
+        return true;
     }
 
-    flags = fcntl(m_fd, F_GETFL, 0);
-    flags = flags | O_NONBLOCK;
-    fcntl(m_fd, F_SETFL, flags);
+    if (errno != EINPROGRESS) {
+        VLOG(1) << "Failed to connect: " << strerror(errno);
+        close();
+        return false;
+    }
+
+    m_state = State::Connecting;
+    return true;
+}
+
+bool TcpSocket::finish_connect() {
+    if (m_state != State::Connecting) {
+        return true;
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+
+    if (::getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0) {
+        error = errno;
+    }
+
+    if (error != 0) {
+        close(true);
+        throw socket_error(std::string("Failed to connect: ") +
+                           strerror(error));
+    }
+
+    // SO_ERROR is also zero while the connection is still pending
+    sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    const auto res =
+        ::getpeername(m_fd, reinterpret_cast<sockaddr *>(&peer), &peer_len);
+
+    if (res != 0 && errno == ENOTCONN) {
+        return false;
+    }
 
     calculate_remote_address();
     update_port_number();
@@ -315,8 +432,10 @@ bool TcpSocket::close(bool fast) {
 }
 
 void TcpSocket::pull_messages() {
-    // always pull more until we get EAGAIN
-    while (true) {
+    // Only read as much as needed for the next message, so the caller
+    // decides how much data to handle at once. Callers that keep receiving
+    // until there are no more messages still read until EAGAIN.
+    while (!m_slicer->has_messages()) {
         auto &buffer = m_slicer->buffer();
 
         if (!buffer.is_valid()) {
@@ -471,6 +590,7 @@ void TcpSocket::wait_send_queue_empty() {
 }
 
 bool TcpSocket::do_send() {
+    const trace::Span span("do_send", m_fd);
     const std::unique_lock send_lock(m_send_mutex);
 
     while (true) {
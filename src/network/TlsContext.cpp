@@ -6,6 +6,8 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include "yael/Trace.h"
+
 namespace yael::network {
 
 TlsContext::TlsContext(TlsSocket &socket)
@@ -28,6 +30,8 @@ void TlsContext::wait_connected() {
 }
 
 void TlsContext::tls_process_data(buffer_t &buffer) {
+    const trace::Span span("tls_process_data", m_socket.get_fileno());
+
     if (m_channel) {
         // may happe during shutdown
         m_channel->received_data(buffer.data(), buffer.size());
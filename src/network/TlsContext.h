@@ -12,11 +12,12 @@
 #include "ClientCredentials.h"
 #include "ServerCredentials.h"
 #include "TlsPolicy.h"
+#include "yael/Pool.h"
 #include "yael/network/TlsSocket.h"
 
 namespace yael::network {
 
-class TlsContext : public Botan::TLS::Callbacks {
+class TlsContext : public Botan::TLS::Callbacks, public Pooled {
   public:
     TlsContext(TlsSocket &socket);
     virtual ~TlsContext() = default;
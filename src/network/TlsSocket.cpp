@@ -60,7 +60,44 @@ bool TlsSocket::connect(const Address &address, const std::string &name) {
     return true;
 }
 
+bool TlsSocket::connect_async(const Address &address,
+                              const std::string &name) {
+    if (!TcpSocket::connect_async(address, name)) {
+        return false;
+    }
+
+    m_state = State::Connecting;
+
+    if (!TcpSocket::is_connecting()) {
+        // Connected right away
+        m_tls_context = std::make_unique<TlsClient>(*this);
+    }
+
+    return true;
+}
+
+bool TlsSocket::finish_connect() {
+    if (!TcpSocket::is_connecting()) {
+        return true;
+    }
+
+    if (!TcpSocket::finish_connect()) {
+        return false;
+    }
+
+    // Start the handshake; tls_session_established() updates the state
+    m_tls_context = std::make_unique<TlsClient>(*this);
+    return true;
+}
+
+bool TlsSocket::is_connecting() const { return m_state == State::Connecting; }
+
 bool TlsSocket::wait_connection_established() {
+    if (!m_tls_context) {
+        // connect_async() is still in progress or failed
+        return false;
+    }
+
     m_tls_context->wait_connected();
     return is_connected();
 }
@@ -106,8 +143,8 @@ bool TlsSocket::do_send() { return TcpSocket::do_send(); }
 bool TlsSocket::is_connected() const { return m_state == State::Connected; }
 
 void TlsSocket::pull_messages() {
-    // always pull more until we get EAGAIN
-    while (true) {
+    // Like TcpSocket, only read until there is a message
+    while (!get_slicer().has_messages()) {
         const bool res = receive_data(m_buffer);
 
         if (!res) {
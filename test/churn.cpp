@@ -18,6 +18,7 @@
 
 #include "yael/DelayedNetworkSocketListener.h"
 #include "yael/EventLoop.h"
+#include "yael/SignalEventListener.h"
 #include "yael/network/TcpSocket.h"
 
 using namespace yael;
@@ -89,10 +90,16 @@ void Peer::on_network_message(yael::network::message_in_t &) {
     // no messages in the churn test
 }
 
-void stop_handler(int) {
-    DLOG(INFO) << "Received signal. Stopping...";
-    yael::EventLoop::get_instance().stop();
-}
+/// Stops the event loop on SIGTERM or SIGINT
+class StopListener : public yael::SignalEventListener {
+  public:
+    StopListener() : SignalEventListener({SIGTERM, SIGINT}) {}
+
+    void on_signal(int) override {
+        DLOG(INFO) << "Received signal. Stopping...";
+        yael::EventLoop::get_instance().stop();
+    }
+};
 
 int do_child(const std::string &host, uint16_t port, uint32_t delay) {
     FLAGS_logbufsecs = 0;
@@ -102,8 +109,7 @@ int do_child(const std::string &host, uint16_t port, uint32_t delay) {
 
     yael::EventLoop::initialize();
     auto &event_loop = yael::EventLoop::get_instance();
-    signal(SIGSTOP, stop_handler);
-    signal(SIGTERM, stop_handler);
+    event_loop.make_event_listener<StopListener>();
 
     for (size_t i = 0; i < NUM_CONNECTS; ++i) {
         auto c = event_loop.make_event_listener<Peer>(host, port, delay);
@@ -182,8 +188,7 @@ void do_listen(int argc, char **argv) {
 
     yael::EventLoop::initialize();
     auto &event_loop = yael::EventLoop::get_instance();
-    signal(SIGSTOP, stop_handler);
-    signal(SIGTERM, stop_handler);
+    event_loop.make_event_listener<StopListener>();
 
     const uint16_t port = std::atoi(argv[2]);
     event_loop.make_event_listener<Acceptor>(port);
@@ -18,6 +18,7 @@
 
 #include "yael/DelayedNetworkSocketListener.h"
 #include "yael/EventLoop.h"
+#include "yael/SignalEventListener.h"
 #include "yael/network/TcpSocket.h"
 
 using namespace yael;
@@ -104,10 +105,16 @@ void Peer::on_network_message(yael::network::message_in_t &msg) {
     }
 }
 
-void stop_handler(int) {
-    LOG(INFO) << "Received signal. Stopping...";
-    yael::EventLoop::get_instance().stop();
-}
+/// Stops the event loop on SIGTERM or SIGINT
+class StopListener : public yael::SignalEventListener {
+  public:
+    StopListener() : SignalEventListener({SIGTERM, SIGINT}) {}
+
+    void on_signal(int) override {
+        LOG(INFO) << "Received signal. Stopping...";
+        yael::EventLoop::get_instance().stop();
+    }
+};
 
 int do_child(const std::string &host, uint16_t port, uint32_t delay) {
     FLAGS_logbufsecs = 0;
@@ -117,8 +124,7 @@ int do_child(const std::string &host, uint16_t port, uint32_t delay) {
 
     yael::EventLoop::initialize();
     auto &event_loop = yael::EventLoop::get_instance();
-    signal(SIGSTOP, stop_handler);
-    signal(SIGTERM, stop_handler);
+    event_loop.make_event_listener<StopListener>();
 
     auto &el = EventLoop::get_instance();
     auto c = event_loop.make_event_listener<Peer>(host, port, delay);
@@ -207,8 +213,7 @@ void do_listen(int argc, char **argv) {
 
     yael::EventLoop::initialize();
     auto &event_loop = yael::EventLoop::get_instance();
-    signal(SIGSTOP, stop_handler);
-    signal(SIGTERM, stop_handler);
+    event_loop.make_event_listener<StopListener>();
 
     const uint16_t port = std::atoi(argv[2]);
     event_loop.make_event_listener<Acceptor>(port);
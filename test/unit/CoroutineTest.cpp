@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <yael/Coroutine.h>
+#include <yael/EventLoop.h>
+#include <yael/network/TcpSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace yael;
+using namespace yael::network;
+
+class CoroutineTest : public testing::Test {};
+
+Task sleep_twice(EventLoop &loop, std::atomic<int> &count) {
+    co_await loop.sleep(std::chrono::milliseconds(10));
+    count += 1;
+
+    co_await loop.sleep(std::chrono::milliseconds(10));
+    count += 1;
+}
+
+TEST(CoroutineTest, sleep) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    std::atomic<int> count = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    sleep_twice(*loop, count);
+
+    while (count < 2) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(20));
+}
+
+/// Counts how often it was destroyed
+class DestructionGuard {
+  public:
+    explicit DestructionGuard(std::atomic<int> &count) : m_count(count) {}
+
+    ~DestructionGuard() { m_count += 1; }
+
+    DestructionGuard(const DestructionGuard &other) = delete;
+
+  private:
+    std::atomic<int> &m_count;
+};
+
+Task sleep_long(EventLoop &loop, std::atomic<int> &resumed,
+                std::atomic<int> &destroyed) {
+    const DestructionGuard guard(destroyed);
+
+    co_await loop.sleep(std::chrono::seconds(60));
+    resumed += 1;
+}
+
+TEST(CoroutineTest, stop_while_sleeping) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    std::atomic<int> resumed = 0;
+    std::atomic<int> destroyed = 0;
+
+    sleep_long(*loop, resumed, destroyed);
+    EXPECT_EQ(0, destroyed);
+
+    loop->stop();
+    loop->wait();
+
+    // The coroutine's state was freed without resuming it
+    EXPECT_EQ(0, resumed);
+    EXPECT_EQ(1, destroyed);
+}
+
+Task echo(std::shared_ptr<AsyncConnection> connection) {
+    while (auto msg = co_await connection->receive()) {
+        std::unique_ptr<uint8_t[]> data(msg->data);
+
+        if (!co_await connection->send(std::move(data), msg->length)) {
+            break;
+        }
+    }
+}
+
+class EchoServer : public NetworkSocketListener {
+  public:
+    explicit EchoServer(const Address &addr) {
+        auto socket = std::make_unique<TcpSocket>();
+
+        if (!socket->listen(addr, 10)) {
+            throw std::runtime_error("Cannot start server: listen failed");
+        }
+
+        NetworkSocketListener::set_socket(std::move(socket),
+                                          SocketType::Acceptor);
+    }
+
+    void on_new_connection(std::unique_ptr<Socket> &&socket) override {
+        echo(event_loop()->make_event_listener<AsyncConnection>(
+            std::move(socket)));
+    }
+};
+
+Task ping(EventLoop &loop, Address addr, uint32_t num_messages,
+          std::atomic<uint32_t> &num_replies) {
+    auto connection = co_await connect(loop, addr);
+
+    if (!connection) {
+        ADD_FAILURE() << "Failed to connect";
+        co_return;
+    }
+
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        const uint32_t value = i;
+
+        if (!co_await connection->send(
+                reinterpret_cast<const uint8_t *>(&value), sizeof(value))) {
+            ADD_FAILURE() << "Failed to send";
+            co_return;
+        }
+
+        auto msg = co_await connection->receive();
+
+        if (!msg) {
+            ADD_FAILURE() << "Connection closed";
+            co_return;
+        }
+
+        uint32_t reply = 0;
+        memcpy(&reply, msg->data, sizeof(reply));
+        delete[] msg->data;
+
+        EXPECT_EQ(value, reply);
+        num_replies += 1;
+    }
+
+    connection->close_socket();
+}
+
+TEST(CoroutineTest, echo) {
+    constexpr uint16_t PORT = 62130;
+    constexpr uint32_t num_messages = 100;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    auto server = loop->make_event_listener<EchoServer>(addr);
+    std::atomic<uint32_t> num_replies = 0;
+
+    ping(*loop, addr, num_messages, num_replies);
+
+    while (num_replies < num_messages) {
+        std::this_thread::yield();
+    }
+
+    server = nullptr;
+}
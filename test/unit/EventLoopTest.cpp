@@ -0,0 +1,777 @@
+#include <gtest/gtest.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <yael/EventLoop.h>
+#include <yael/FdEventListener.h>
+#include <yael/NetworkSocketListener.h>
+#include <yael/TimeEventListener.h>
+#include <yael/network/TcpSocket.h>
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace yael;
+
+class EventLoopTest : public testing::Test {};
+
+class CountingTimeListener : public TimeEventListener {
+  public:
+    explicit CountingTimeListener(std::atomic<int> &count) : m_count(count) {}
+
+    void on_time_event() override { m_count += 1; }
+
+  private:
+    std::atomic<int> &m_count;
+};
+
+TEST(EventLoopTest, batched_dispatch) {
+    constexpr int32_t max_events = 16;
+    constexpr int num_listeners = 48;
+
+    event_loop_config_t config;
+    config.num_threads = 1;
+    config.max_events = max_events;
+
+    auto loop = EventLoop::create(config);
+
+    // Keep the only worker busy until all listeners are ready
+    std::atomic<bool> blocked = false;
+    std::atomic<bool> release = false;
+
+    loop->post([&]() {
+        blocked = true;
+
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+
+    while (!blocked) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<int> count = 0;
+    std::vector<std::shared_ptr<FdEventListener>> listeners;
+
+    for (int i = 0; i < num_listeners; ++i) {
+        auto listener = std::make_shared<FdEventListener>(
+            eventfd(1, EFD_NONBLOCK), [&count](FdEventListener &self) {
+                uint64_t val = 0;
+
+                if (::read(self.fd(), &val, sizeof(val)) == sizeof(val)) {
+                    count += 1;
+                }
+            });
+
+        loop->register_event_listener(listener);
+        listeners.push_back(listener);
+    }
+
+    release = true;
+
+    while (count < num_listeners) {
+        std::this_thread::yield();
+    }
+
+    for (auto &listener : listeners) {
+        listener->close_socket();
+    }
+
+    loop->stop();
+    loop->wait();
+
+    // Ready listeners are harvested max_events at a time
+    auto total = loop->stats().total();
+    EXPECT_GE(total.events, static_cast<uint64_t>(num_listeners));
+    EXPECT_GT(total.events, total.wakeups);
+}
+
+class ShardedEventLoopTest : public testing::TestWithParam<ShardPolicy> {};
+
+namespace {
+
+/// Remembers which worker thread handled its events
+class ThreadRecorder {
+  public:
+    std::shared_ptr<FdEventListener> make_listener() {
+        return std::make_shared<FdEventListener>(
+            eventfd(0, EFD_NONBLOCK), [this](FdEventListener &self) {
+                uint64_t val = 0;
+
+                if (::read(self.fd(), &val, sizeof(val)) != sizeof(val)) {
+                    return;
+                }
+
+                const std::unique_lock lock(m_mutex);
+                m_threads.push_back(std::this_thread::get_id());
+            });
+    }
+
+    /// Signal the listener and wait for it to handle the event
+    std::thread::id trigger(FdEventListener &listener) {
+        const uint64_t val = 1;
+        EXPECT_EQ(static_cast<ssize_t>(sizeof(val)),
+                  ::write(listener.fd(), &val, sizeof(val)));
+
+        while (true) {
+            {
+                const std::unique_lock lock(m_mutex);
+
+                if (!m_threads.empty()) {
+                    auto thread = m_threads.back();
+                    m_threads.clear();
+                    return thread;
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::vector<std::thread::id> m_threads;
+};
+
+} // namespace
+
+TEST_P(ShardedEventLoopTest, distribute_listeners) {
+    constexpr size_t num_preassigned = 4;
+    constexpr size_t num_listeners = 8;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+    config.sharded = true;
+    config.shard_policy = GetParam();
+
+    auto loop = EventLoop::create(config);
+    ASSERT_EQ(4U, loop->num_shards());
+
+    ThreadRecorder recorder;
+    std::vector<std::shared_ptr<FdEventListener>> listeners;
+
+    // Every shard has a single worker, so threads identify shards
+    for (size_t i = 0; i < num_preassigned; ++i) {
+        auto listener = recorder.make_listener();
+        loop->register_event_listener(listener, 0);
+        listeners.push_back(listener);
+    }
+
+    const auto first_shard = recorder.trigger(*listeners.front());
+
+    for (auto &listener : listeners) {
+        EXPECT_EQ(first_shard, recorder.trigger(*listener));
+    }
+
+    std::map<std::thread::id, size_t> counts;
+
+    for (size_t i = 0; i < num_listeners; ++i) {
+        auto listener = recorder.make_listener();
+        loop->register_event_listener(listener);
+        listeners.push_back(listener);
+
+        counts[recorder.trigger(*listener)] += 1;
+    }
+
+    if (GetParam() == ShardPolicy::RoundRobin) {
+        // Ignores how many listeners the shards have already
+        EXPECT_EQ(4U, counts.size());
+
+        for (auto &[thread, count] : counts) {
+            EXPECT_EQ(num_listeners / 4, count);
+        }
+    } else {
+        // Fills up the other shards first (4 + 0, 0 + 3, 0 + 3, 0 + 2)
+        EXPECT_EQ(3U, counts.size());
+        EXPECT_EQ(0U, counts.count(first_shard));
+
+        for (auto &[thread, count] : counts) {
+            EXPECT_GE(count, 2U);
+            EXPECT_LE(count, 3U);
+        }
+    }
+
+    for (auto &listener : listeners) {
+        listener->close_socket();
+    }
+
+    loop->stop();
+    loop->wait();
+}
+
+INSTANTIATE_TEST_CASE_P(ShardedEventLoopTests, ShardedEventLoopTest,
+                        testing::Values(ShardPolicy::RoundRobin,
+                                        ShardPolicy::LeastLoaded));
+
+TEST(EventLoopTest, io_uring_backend) {
+    constexpr int num_listeners = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.backend = EventBackend::IoUring;
+
+    EventLoop::initialize(config);
+    auto &el = EventLoop::get_instance();
+
+    if (el.backend() != EventBackend::IoUring) {
+        LOG(WARNING) << "io_uring not supported; testing the fallback instead";
+    }
+
+    std::atomic<int> count = 0;
+    std::vector<std::shared_ptr<CountingTimeListener>> listeners;
+
+    for (int i = 0; i < num_listeners; ++i) {
+        auto hdl = el.make_event_listener<CountingTimeListener>(count);
+        hdl->schedule(10);
+        hdl->schedule(20);
+        listeners.push_back(hdl);
+    }
+
+    while (count < 2 * num_listeners) {
+        // pass
+    }
+
+    el.stop();
+    el.wait();
+
+    EventLoop::destroy();
+
+    EXPECT_EQ(2 * num_listeners, count);
+}
+
+namespace {
+
+constexpr size_t ECHO_SEND_QUEUE_SIZE = 16 * 1024 * 1024;
+
+/// Sends every message back
+class EchoConnection : public NetworkSocketListener {
+  public:
+    explicit EchoConnection(std::unique_ptr<network::Socket> &&socket)
+        : NetworkSocketListener(std::move(socket), SocketType::Connection) {}
+
+    void on_network_message(network::message_in_t &msg) override {
+        send(std::unique_ptr<uint8_t[]>(msg.data), msg.length);
+    }
+};
+
+class EchoServer : public NetworkSocketListener {
+  public:
+    explicit EchoServer(const network::Address &addr) {
+        auto socket = std::make_unique<network::TcpSocket>(
+            network::MessageMode::Datagram, ECHO_SEND_QUEUE_SIZE);
+
+        if (!socket->listen(addr, 10)) {
+            throw std::runtime_error("Cannot start server: listen failed");
+        }
+
+        set_socket(std::move(socket), SocketType::Acceptor);
+    }
+
+    void on_new_connection(std::unique_ptr<network::Socket> &&socket) override {
+        auto conn = event_loop()->allocate_event_listener<EchoConnection>(
+            std::move(socket));
+        event_loop()->register_event_listener(conn);
+
+        const std::unique_lock lock(m_mutex);
+        m_connections.push_back(std::move(conn));
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<EchoConnection>> m_connections;
+};
+
+/// Checks the content of the echoed messages
+class EchoClient : public NetworkSocketListener {
+  public:
+    explicit EchoClient(const network::Address &addr) {
+        auto socket = std::make_unique<network::TcpSocket>(
+            network::MessageMode::Datagram, ECHO_SEND_QUEUE_SIZE);
+
+        if (!socket->connect(addr)) {
+            throw std::runtime_error("Connection failed");
+        }
+
+        set_socket(std::move(socket), SocketType::Connection);
+    }
+
+    void on_network_message(network::message_in_t &msg) override {
+        const std::unique_ptr<uint8_t[]> data(msg.data);
+        const auto expected = static_cast<uint8_t>(m_num_received % 256);
+
+        for (size_t idx = 0; idx < msg.length; ++idx) {
+            if (data[idx] != expected) {
+                m_corrupted = true;
+            }
+        }
+
+        m_num_received += 1;
+    }
+
+    std::atomic<uint32_t> m_num_received = 0;
+    std::atomic<bool> m_corrupted = false;
+};
+
+} // namespace
+
+TEST(EventLoopTest, io_uring_echo) {
+    constexpr uint16_t PORT = 62136;
+    constexpr uint32_t num_messages = 128;
+    constexpr uint32_t len = 64 * 1024;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.backend = EventBackend::IoUring;
+
+    auto loop = EventLoop::create(config);
+
+    if (loop->backend() != EventBackend::IoUring) {
+        GTEST_SKIP() << "io_uring not supported";
+    }
+
+    const network::Address addr = network::resolve_URL("localhost", PORT);
+    auto server = loop->make_event_listener<EchoServer>(addr);
+    auto client = loop->make_event_listener<EchoClient>(addr);
+
+    // More than fits into the socket buffers, so both ends have to wait for
+    // the socket to become writable (read-write mode) at some point
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        auto data = std::make_unique<uint8_t[]>(len);
+        memset(data.get(), static_cast<int>(i % 256), len);
+        client->send(std::move(data), len);
+    }
+
+    while (client->m_num_received < num_messages) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_FALSE(client->m_corrupted);
+
+    client->close_socket();
+    server->close_socket();
+
+    loop->stop();
+    loop->wait();
+
+    EXPECT_EQ(nullptr, client->event_loop());
+    EXPECT_EQ(nullptr, server->event_loop());
+}
+
+TEST(EventLoopTest, io_uring_fd_rearm) {
+    constexpr int num_events = 100;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.backend = EventBackend::IoUring;
+
+    auto loop = EventLoop::create(config);
+
+    if (loop->backend() != EventBackend::IoUring) {
+        GTEST_SKIP() << "io_uring not supported";
+    }
+
+    std::atomic<int> num_reads = 0;
+    std::atomic<int> num_writable = 0;
+
+    auto read_value = [&num_reads](FdEventListener &self) {
+        uint64_t val = 0;
+
+        if (::read(self.fd(), &val, sizeof(val)) == sizeof(val)) {
+            num_reads += 1;
+        }
+    };
+
+    auto listener = loop->make_event_listener<FdEventListener>(
+        eventfd(0, EFD_NONBLOCK), read_value, [&](FdEventListener &self) {
+            num_writable += 1;
+            self.set_mode(EventListener::Mode::ReadOnly);
+        });
+
+    // The poll request is re-armed after every event
+    for (int i = 0; i < num_events; ++i) {
+        const uint64_t val = 1;
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(val)),
+                  ::write(listener->fd(), &val, sizeof(val)));
+
+        while (num_reads <= i) {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_EQ(num_events, num_reads);
+
+    // Mode changes replace the poll request
+    EXPECT_EQ(0, num_writable);
+    listener->set_mode(EventListener::Mode::ReadWrite);
+
+    while (num_writable == 0) {
+        std::this_thread::yield();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(1, num_writable);
+
+    // The fd number is likely reused right away. Completions for the old
+    // listener must not reach the new one (and vice versa)
+    listener->close_socket();
+
+    std::atomic<int> num_new_reads = 0;
+    auto replacement = loop->make_event_listener<FdEventListener>(
+        eventfd(0, EFD_NONBLOCK), [&](FdEventListener &self) {
+            uint64_t val = 0;
+
+            if (::read(self.fd(), &val, sizeof(val)) == sizeof(val)) {
+                num_new_reads += 1;
+            }
+        });
+
+    const uint64_t val = 1;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(val)),
+              ::write(replacement->fd(), &val, sizeof(val)));
+
+    while (num_new_reads == 0) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(num_events, num_reads);
+    EXPECT_EQ(1, num_new_reads);
+
+    replacement->close_socket();
+}
+
+TEST(EventLoopTest, post) {
+    // More than fit into the task queues
+    constexpr int num_tasks = 5000;
+
+    EventLoop::initialize(2);
+    auto &el = EventLoop::get_instance();
+
+    std::atomic<int> count = 0;
+
+    for (int i = 0; i < num_tasks; ++i) {
+        if (i % 2 == 0) {
+            EXPECT_TRUE(el.post([&count]() { count += 1; }));
+        } else {
+            EXPECT_TRUE(el.post(Closure([&count]() { count += 1; })));
+        }
+    }
+
+    while (count < num_tasks) {
+        // pass
+    }
+
+    el.stop();
+    el.wait();
+
+    EXPECT_FALSE(el.post([]() {}));
+
+    EventLoop::destroy();
+
+    EXPECT_EQ(num_tasks, count);
+}
+
+TEST(EventLoopTest, post_from_worker) {
+    event_loop_config_t config;
+    config.num_threads = 4;
+    config.sharded = true;
+
+    EventLoop::initialize(config);
+    auto &el = EventLoop::get_instance();
+
+    std::atomic<bool> same_thread = false;
+    std::atomic<bool> done = false;
+
+    el.post([&]() {
+        auto outer = std::this_thread::get_id();
+
+        EventLoop::get_instance().post([&, outer]() {
+            same_thread = (outer == std::this_thread::get_id());
+            done = true;
+        });
+    });
+
+    while (!done) {
+        // pass
+    }
+
+    el.stop();
+    el.wait();
+
+    EventLoop::destroy();
+
+    EXPECT_TRUE(same_thread);
+}
+
+TEST(EventLoopTest, multiple_loops) {
+    constexpr int num_listeners = 10;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    // Does not use the global instance
+    auto loop1 = EventLoop::create(config);
+    auto loop2 = EventLoop::create(config);
+
+    ASSERT_FALSE(EventLoop::is_initialized());
+
+    std::atomic<int> count1 = 0;
+    std::atomic<int> count2 = 0;
+    std::vector<std::shared_ptr<CountingTimeListener>> listeners;
+
+    for (int i = 0; i < num_listeners; ++i) {
+        auto hdl1 = loop1->make_event_listener<CountingTimeListener>(count1);
+        auto hdl2 = loop2->make_event_listener<CountingTimeListener>(count2);
+
+        EXPECT_EQ(loop1.get(), hdl1->event_loop());
+        EXPECT_EQ(loop2.get(), hdl2->event_loop());
+
+        hdl1->schedule(10);
+        hdl2->schedule(10);
+
+        listeners.push_back(hdl1);
+        listeners.push_back(hdl2);
+    }
+
+    while (count1 < num_listeners || count2 < num_listeners) {
+        // pass
+    }
+
+    loop1.reset();
+
+    // The other loop is not affected
+    EXPECT_TRUE(loop2->is_okay());
+
+    std::atomic<bool> done = false;
+    loop2->post([&done]() { done = true; });
+
+    while (!done) {
+        // pass
+    }
+
+    loop2->stop();
+    loop2->wait();
+    loop2.reset();
+
+    for (auto &listener : listeners) {
+        EXPECT_EQ(nullptr, listener->event_loop());
+    }
+
+    EXPECT_EQ(num_listeners, count1);
+    EXPECT_EQ(num_listeners, count2);
+}
+
+TEST(EventLoopTest, pin_workers) {
+    // CPU 0 might not be available to this process (e.g., in a container)
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(available), &available));
+
+    int32_t first_cpu = -1;
+
+    for (int32_t idx = 0; idx < CPU_SETSIZE; ++idx) {
+        if (CPU_ISSET(idx, &available)) {
+            first_cpu = idx;
+            break;
+        }
+    }
+
+    ASSERT_GE(first_cpu, 0);
+
+    event_loop_config_t config;
+    config.cpus = {first_cpu};
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> cpu = -1;
+    loop->post([&cpu]() { cpu = sched_getcpu(); });
+
+    while (cpu < 0) {
+        // pass
+    }
+
+    EXPECT_EQ(first_cpu, cpu);
+}
+
+namespace {
+
+/**
+ * Signal an eventfd a few times, with pauses in between
+ * @return how often events arrived while a worker was busy polling
+ */
+uint64_t count_busy_poll_hits(uint32_t busy_poll_us) {
+    constexpr int num_writes = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 1;
+    config.sharded = true;
+    config.busy_poll_us = busy_poll_us;
+
+    auto loop = EventLoop::create(config);
+    std::atomic<int> num_reads = 0;
+
+    auto listener = loop->make_event_listener<FdEventListener>(
+        eventfd(0, EFD_NONBLOCK), [&num_reads](FdEventListener &self) {
+            uint64_t val = 0;
+
+            if (::read(self.fd(), &val, sizeof(val)) == sizeof(val)) {
+                num_reads += 1;
+            }
+        });
+
+    for (int i = 0; i < num_writes; ++i) {
+        // The worker starts busy polling once it is done with the last event
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+        const uint64_t val = 1;
+        EXPECT_EQ(static_cast<ssize_t>(sizeof(val)),
+                  ::write(listener->fd(), &val, sizeof(val)));
+
+        while (num_reads <= i) {
+            std::this_thread::yield();
+        }
+    }
+
+    listener->close_socket();
+
+    loop->stop();
+    loop->wait();
+
+    return loop->stats().total().busy_poll_hits;
+}
+
+} // namespace
+
+TEST(EventLoopTest, busy_poll) {
+    // Polls for much longer than the pauses between events, so the worker
+    // picks up (almost) all of them without blocking
+    EXPECT_GT(count_busy_poll_hits(100 * 1000), 0U);
+
+    EXPECT_EQ(0U, count_busy_poll_hits(0));
+}
+
+TEST(EventLoopTest, stats) {
+    constexpr int num_listeners = 10;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.measure_latency = true;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> count = 0;
+    std::vector<std::shared_ptr<CountingTimeListener>> listeners;
+
+    for (int i = 0; i < num_listeners; ++i) {
+        auto hdl = loop->make_event_listener<CountingTimeListener>(count);
+        hdl->schedule(10);
+        listeners.push_back(hdl);
+    }
+
+    std::atomic<bool> done = false;
+    loop->post([&done]() { done = true; });
+
+    while (count < num_listeners || !done) {
+        // pass
+    }
+
+    loop->stop();
+    loop->wait();
+
+    auto stats = loop->stats();
+    ASSERT_EQ(2U, stats.workers.size());
+
+    auto total = stats.total();
+    EXPECT_GE(total.events, static_cast<uint64_t>(num_listeners));
+    EXPECT_EQ(1U, total.tasks);
+    EXPECT_EQ(total.events, total.handler_time.count());
+    EXPECT_EQ(total.events, total.queue_delay.count());
+    EXPECT_LE(total.handler_time.percentile(50), total.handler_time.max());
+}
+
+TEST(EventLoopTest, elastic_workers) {
+    constexpr int32_t max_threads = 4;
+
+    event_loop_config_t config;
+    config.num_threads = max_threads;
+    config.min_threads = 1;
+    config.idle_timeout = std::chrono::milliseconds(20);
+
+    auto loop = EventLoop::create(config);
+    EXPECT_EQ(1U, loop->num_workers());
+
+    std::atomic<int> running = 0;
+    std::atomic<bool> release = false;
+
+    // Every task occupies a worker until released, so more are needed
+    for (int i = 0; i < max_threads; ++i) {
+        loop->post([&]() {
+            running += 1;
+
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+
+        while (running < i + 1) {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_EQ(static_cast<size_t>(max_threads), loop->num_workers());
+    release = true;
+
+    // Idle workers retire again (but the remaining one keeps working)
+    while (loop->num_workers() > 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::atomic<bool> done = false;
+    loop->post([&done]() { done = true; });
+
+    while (!done) {
+        std::this_thread::yield();
+    }
+
+    loop->stop();
+    loop->wait();
+}
+
+TEST(EventLoopTest, cached_time) {
+    event_loop_config_t config;
+    config.num_threads = 1;
+    config.clock_source = ClockSource::MonotonicCoarse;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<bool> done = false;
+    uint64_t first = 0;
+    uint64_t second = 0;
+    uint64_t updated = 0;
+
+    loop->post([&]() {
+        first = loop->get_time_ns();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        // Does not change until the worker wakes up again
+        second = loop->get_time_ns();
+        updated = loop->update_time();
+
+        done = true;
+    });
+
+    while (!done) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(first, second);
+    EXPECT_GE(updated, first + 40'000'000);
+    EXPECT_GE(loop->get_time(), updated / 1'000'000);
+
+    loop->stop();
+    loop->wait();
+}
@@ -0,0 +1,138 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <yael/EventLoop.h>
+#include <yael/FdEventListener.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace yael;
+
+class FdEventTest : public testing::Test {};
+
+TEST(FdEventTest, pipe) {
+    constexpr int num_writes = 100;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    int fds[2];
+    ASSERT_EQ(0, pipe2(fds, O_NONBLOCK));
+
+    std::atomic<int> num_bytes = 0;
+    std::atomic<bool> hung_up = false;
+
+    auto listener = loop->make_event_listener<FdEventListener>(
+        fds[0], [&](FdEventListener &self) {
+            char buffer[64];
+
+            while (true) {
+                auto res = ::read(self.fd(), buffer, sizeof(buffer));
+
+                if (res > 0) {
+                    num_bytes += static_cast<int>(res);
+                } else {
+                    if (res == 0) {
+                        // The write end was closed
+                        hung_up = true;
+                        self.close_socket();
+                    }
+
+                    break;
+                }
+            }
+        });
+
+    for (int i = 0; i < num_writes; ++i) {
+        ASSERT_EQ(1, ::write(fds[1], "x", 1));
+    }
+
+    while (num_bytes < num_writes) {
+        std::this_thread::yield();
+    }
+
+    ::close(fds[1]);
+
+    while (!hung_up) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_FALSE(listener->is_valid());
+    EXPECT_EQ(num_writes, num_bytes);
+}
+
+TEST(FdEventTest, write_mode) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> num_writable = 0;
+    std::atomic<uint64_t> value = 0;
+
+    auto listener = loop->make_event_listener<FdEventListener>(
+        eventfd(0, EFD_NONBLOCK),
+        [&](FdEventListener &self) {
+            uint64_t val = 0;
+
+            if (::read(self.fd(), &val, sizeof(val)) == sizeof(val)) {
+                value += val;
+            }
+        },
+        [&](FdEventListener &self) {
+            const uint64_t val = 42;
+            EXPECT_EQ(static_cast<ssize_t>(sizeof(val)),
+                      ::write(self.fd(), &val, sizeof(val)));
+
+            num_writable += 1;
+            self.set_mode(EventListener::Mode::ReadOnly);
+        });
+
+    // Not watching for writes yet
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(0, num_writable);
+
+    listener->set_mode(EventListener::Mode::ReadWrite);
+
+    while (value < 42) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(1, num_writable);
+    EXPECT_EQ(42U, value);
+
+    listener->close_socket();
+}
+
+TEST(FdEventTest, hangup_without_read_callback) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    std::atomic<int> num_errors = 0;
+
+    // Only interested in writing
+    auto listener = loop->make_event_listener<FdEventListener>(
+        fds[0], FdEventListener::Callback{}, FdEventListener::Callback{},
+        [&](FdEventListener &) { num_errors += 1; });
+
+    ::close(fds[1]);
+
+    while (listener->is_valid()) {
+        std::this_thread::yield();
+    }
+
+    // Give the event loop a chance to report the hangup again
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    EXPECT_EQ(1, num_errors);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <yael/Pool.h>
+
+#include <memory>
+#include <thread>
+
+using namespace yael;
+
+class PoolTest : public testing::Test {};
+
+TEST(PoolTest, reuse_blocks) {
+    auto *first = pool_allocate(100);
+    pool_deallocate(first, 100);
+
+    // Same size class
+    auto *second = pool_allocate(120);
+    EXPECT_EQ(first, second);
+
+    pool_deallocate(second, 120);
+}
+
+TEST(PoolTest, large_blocks) {
+    auto *block = pool_allocate(MAX_POOLED_SIZE + 1);
+    ASSERT_NE(nullptr, block);
+
+    pool_deallocate(block, MAX_POOLED_SIZE + 1);
+}
+
+TEST(PoolTest, free_on_other_thread) {
+    auto *block = pool_allocate(256);
+
+    std::thread thread([block]() {
+        pool_deallocate(block, 256);
+
+        // The block now belongs to this thread, which returns it to the heap
+        // on exit
+        EXPECT_EQ(block, pool_allocate(256));
+        pool_deallocate(block, 256);
+    });
+
+    thread.join();
+}
+
+class PooledObject : public Pooled {
+  public:
+    virtual ~PooledObject() = default;
+
+    uint64_t value = 0;
+};
+
+class LargerPooledObject : public PooledObject {
+  public:
+    uint8_t data[1000];
+};
+
+TEST(PoolTest, pooled_classes) {
+    std::unique_ptr<PooledObject> obj = std::make_unique<LargerPooledObject>();
+    auto *address = obj.get();
+    obj.reset();
+
+    // Deleted with the size of the derived class
+    obj = std::make_unique<LargerPooledObject>();
+    EXPECT_EQ(address, obj.get());
+
+    auto shared = std::allocate_shared<PooledObject>(PoolAllocator<PooledObject>());
+    shared->value = 42;
+    EXPECT_EQ(42U, shared->value);
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <yael/EventLoop.h>
+#include <yael/network/Resolver.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace yael;
+using namespace yael::network;
+
+class ResolverTest : public testing::Test {};
+
+TEST(ResolverTest, resolve_localhost) {
+    constexpr int num_lookups = 10;
+    constexpr uint16_t PORT = 1234;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    Resolver resolver(*loop);
+
+    std::mutex mutex;
+    std::vector<std::optional<Address>> results;
+    std::atomic<int> count = 0;
+
+    for (int i = 0; i < num_lookups; ++i) {
+        resolver.resolve("localhost", PORT + i, false,
+                         [&](std::optional<Address> address) {
+                             const std::unique_lock lock(mutex);
+                             results.push_back(address);
+                             count += 1;
+                         });
+    }
+
+    while (count < num_lookups) {
+        std::this_thread::yield();
+    }
+
+    for (auto &result : results) {
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ("127.0.0.1", result->IP);
+        EXPECT_GE(result->PortNumber, PORT);
+    }
+
+    auto cached = resolver.lookup("localhost", PORT);
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_EQ(Address("127.0.0.1", PORT), *cached);
+
+    resolver.clear_cache();
+    EXPECT_FALSE(resolver.lookup("localhost", PORT).has_value());
+}
+
+TEST(ResolverTest, unknown_host) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    Resolver resolver(*loop);
+
+    std::atomic<bool> done = false;
+    std::optional<Address> result;
+
+    resolver.resolve("does-not-exist.invalid", 80, false,
+                     [&](std::optional<Address> address) {
+                         result = address;
+                         done = true;
+                     });
+
+    while (!done) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_FALSE(result.has_value());
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <unistd.h>
+#include <yael/EventLoop.h>
+#include <yael/SignalEventListener.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace yael;
+
+class SignalEventTest : public testing::Test {};
+
+class CountingSignalListener : public SignalEventListener {
+  public:
+    explicit CountingSignalListener(std::atomic<int> &count)
+        : SignalEventListener({SIGUSR1, SIGUSR2}), m_count(count) {}
+
+    void on_signal(int signo) override {
+        if (signo == SIGUSR1) {
+            m_count += 1;
+        } else if (signo == SIGUSR2) {
+            m_count += 100;
+        }
+    }
+
+  private:
+    std::atomic<int> &m_count;
+};
+
+TEST(SignalEventTest, receive) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> count = 0;
+    auto listener = loop->make_event_listener<CountingSignalListener>(count);
+
+    ASSERT_EQ(0, kill(getpid(), SIGUSR1));
+
+    while (count < 1) {
+        std::this_thread::yield();
+    }
+
+    ASSERT_EQ(0, kill(getpid(), SIGUSR2));
+
+    while (count < 101) {
+        std::this_thread::yield();
+    }
+
+    listener->close_socket();
+    EXPECT_FALSE(listener->is_valid());
+    EXPECT_EQ(101, count);
+}
@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
+#include <sys/socket.h>
 #include <yael/EventLoop.h>
 #include <yael/NetworkSocketListener.h>
 #include <yael/network/TcpSocket.h>
 #include <yael/network/TlsSocket.h>
 
+#include <algorithm>
 #include <list>
 #include <optional>
 #include <thread>
@@ -240,3 +242,527 @@ TEST_P(SocketTest, first_in_first_out) {
 
 INSTANTIATE_TEST_CASE_P(SocketTests, SocketTest,
                         testing::Values(ProtocolType::TCP, ProtocolType::TLS));
+
+class ReusePortAcceptor : public yael::NetworkSocketListener {
+  public:
+    ReusePortAcceptor(const Address &addr, std::atomic<int> &count)
+        : m_count(count) {
+        auto socket = std::make_unique<TcpSocket>();
+        socket->set_reuse_port(true);
+
+        if (!socket->listen(addr, 10)) {
+            throw std::runtime_error("Cannot start server: listen failed");
+        }
+
+        NetworkSocketListener::set_socket(std::move(socket),
+                                          SocketType::Acceptor);
+    }
+
+    void on_new_connection(std::unique_ptr<Socket> &&socket) override {
+        std::unique_lock lock(m_mutex);
+        m_sockets.push_back(std::move(socket));
+        m_count += 1;
+    }
+
+  private:
+    std::atomic<int> &m_count;
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Socket>> m_sockets;
+};
+
+/// Remembers which worker thread handled its messages
+class LocalConnection : public Connection {
+  public:
+    explicit LocalConnection(std::thread::id acceptor_thread)
+        : m_acceptor_thread(acceptor_thread) {}
+
+    void on_network_message(message_in_t &msg) override {
+        m_local = std::this_thread::get_id() == m_acceptor_thread;
+        m_received = true;
+
+        Connection::on_network_message(msg);
+    }
+
+    bool received() const { return m_received; }
+
+    bool is_local() const { return m_local; }
+
+  private:
+    const std::thread::id m_acceptor_thread;
+
+    std::atomic<bool> m_received = false;
+    std::atomic<bool> m_local = false;
+};
+
+class LocalAcceptor : public yael::NetworkSocketListener {
+  public:
+    explicit LocalAcceptor(const Address &addr) {
+        auto socket = std::make_unique<TcpSocket>();
+        socket->set_reuse_port(true);
+
+        if (!socket->listen(addr, 10)) {
+            throw std::runtime_error("Cannot start server: listen failed");
+        }
+
+        NetworkSocketListener::set_socket(std::move(socket),
+                                          SocketType::Acceptor);
+    }
+
+    void on_new_connection(std::unique_ptr<Socket> &&socket) override {
+        auto conn = event_loop()->allocate_event_listener<LocalConnection>(
+            std::this_thread::get_id());
+        conn->set_socket(std::move(socket), SocketType::Connection);
+        event_loop()->register_event_listener(conn);
+
+        std::unique_lock lock(m_mutex);
+        m_connections.push_back(std::move(conn));
+    }
+
+    std::vector<std::shared_ptr<LocalConnection>> connections() {
+        std::unique_lock lock(m_mutex);
+        return m_connections;
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<LocalConnection>> m_connections;
+};
+
+TEST(ReusePortTest, sharded_acceptors) {
+    constexpr uint16_t PORT = 62124;
+    constexpr int num_connections = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+    config.sharded = true;
+
+    EventLoop::initialize(config);
+    auto &el = EventLoop::get_instance();
+
+    const Address addr = resolve_URL("localhost", PORT);
+
+    std::atomic<int> count = 0;
+    auto acceptors = el.make_reuse_port_acceptors<ReusePortAcceptor>(
+        addr, std::ref(count));
+
+    ASSERT_EQ(el.num_shards(), acceptors.size());
+
+    std::vector<std::shared_ptr<Connection>> connections;
+
+    for (int i = 0; i < num_connections; ++i) {
+        auto conn = el.make_event_listener<Connection>(addr, ProtocolType::TCP);
+        connections.push_back(conn);
+    }
+
+    while (count < num_connections) {
+        // pass
+    }
+
+    for (auto &acceptor : acceptors) {
+        EXPECT_EQ(PORT, acceptor->socket().port());
+    }
+
+    acceptors.clear();
+    connections.clear();
+
+    el.stop();
+    el.wait();
+
+    EventLoop::destroy();
+
+    EXPECT_EQ(num_connections, count);
+}
+
+TEST(ReusePortTest, accepted_connections_stay_local) {
+    constexpr uint16_t PORT = 62134;
+    constexpr size_t num_connections = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+    config.sharded = true;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    auto acceptors = loop->make_reuse_port_acceptors<LocalAcceptor>(addr);
+
+    std::vector<std::shared_ptr<Connection>> connections;
+    const std::string msg = "hello";
+
+    for (size_t i = 0; i < num_connections; ++i) {
+        auto conn =
+            loop->make_event_listener<Connection>(addr, ProtocolType::TCP);
+        conn->send(reinterpret_cast<const uint8_t *>(msg.c_str()),
+                   msg.size() + 1);
+        connections.push_back(conn);
+    }
+
+    std::vector<std::shared_ptr<LocalConnection>> accepted;
+
+    while (true) {
+        accepted.clear();
+
+        for (auto &acceptor : acceptors) {
+            auto conns = acceptor->connections();
+            accepted.insert(accepted.end(), conns.begin(), conns.end());
+        }
+
+        const bool done =
+            accepted.size() == num_connections &&
+            std::all_of(accepted.begin(), accepted.end(),
+                        [](auto &conn) { return conn->received(); });
+
+        if (done) {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto &conn : accepted) {
+        EXPECT_TRUE(conn->is_local());
+    }
+
+    acceptors.clear();
+    accepted.clear();
+    connections.clear();
+
+    loop->stop();
+    loop->wait();
+}
+
+class EdgeTriggeredServer : public yael::NetworkSocketListener {
+  public:
+    EdgeTriggeredServer(const Address &addr, std::shared_ptr<Connection> conn)
+        : m_connection(std::move(conn)) {
+        auto socket = std::make_unique<TcpSocket>(
+            MessageMode::Datagram, Connection::MAX_SEND_QUEUE_SIZE);
+
+        if (!socket->listen(addr, 10)) {
+            throw std::runtime_error("Cannot start server: listen failed");
+        }
+
+        set_edge_triggered(true);
+        NetworkSocketListener::set_socket(std::move(socket),
+                                          SocketType::Acceptor);
+    }
+
+    void on_new_connection(std::unique_ptr<Socket> &&socket) override {
+        m_connection->set_edge_triggered(true);
+        m_connection->set_socket(std::move(socket), SocketType::Connection);
+        event_loop()->register_event_listener(m_connection);
+    }
+
+  private:
+    std::shared_ptr<Connection> m_connection;
+};
+
+TEST(EdgeTriggeredTest, send_many) {
+    constexpr uint16_t PORT = 62125;
+    constexpr uint32_t num_messages = 1000;
+    constexpr uint32_t len = 10000;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+    config.max_events = 8;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    auto conn1 = loop->allocate_event_listener<Connection>();
+    auto server = loop->make_event_listener<EdgeTriggeredServer>(addr, conn1);
+
+    auto conn2 = std::make_shared<Connection>(addr, ProtocolType::TCP);
+    conn2->set_edge_triggered(true);
+    loop->register_event_listener(conn2);
+
+    conn1->wait_for_connection();
+    conn2->wait_for_connection();
+
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        auto data = std::make_unique<uint8_t[]>(len);
+        memset(data.get(), static_cast<int>(i % 256), len);
+        conn2->send(std::move(data), len, true);
+
+        auto other = std::make_unique<uint8_t[]>(len);
+        memset(other.get(), static_cast<int>(i % 256), len);
+        conn1->send(std::move(other), len, true);
+    }
+
+    for (auto &receiver : {conn1, conn2}) {
+        for (uint32_t i = 0; i < num_messages; ++i) {
+            std::optional<message_in_t> msg;
+
+            while (!msg) {
+                msg = receiver->receive();
+            }
+
+            ASSERT_EQ(len, msg->length);
+            ASSERT_EQ(i % 256, msg->data[len - 1]);
+
+            delete[] msg->data;
+        }
+    }
+
+    server = nullptr;
+    conn1 = conn2 = nullptr;
+}
+
+/// Reads slowly, so the sender still has queued data when it shuts down
+class SlowConnection : public Connection {
+  public:
+    using Connection::Connection;
+
+    void on_network_message(message_in_t &msg) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        Connection::on_network_message(msg);
+    }
+};
+
+TEST(DrainTest, flushes_send_queue) {
+    constexpr uint16_t PORT = 62126;
+    constexpr uint32_t num_messages = 4000;
+    constexpr uint32_t len = 10000;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    // The client runs on its own loop, so it keeps receiving while the
+    // server drains
+    auto server_loop = EventLoop::create(config);
+    auto client_loop = EventLoop::create(config);
+
+    const Address addr = resolve_URL("localhost", PORT);
+
+    auto conn1 = server_loop->allocate_event_listener<Connection>();
+    auto server =
+        server_loop->make_event_listener<EdgeTriggeredServer>(addr, conn1);
+    auto conn2 = client_loop->make_event_listener<SlowConnection>(
+        addr, ProtocolType::TCP);
+
+    conn1->wait_for_connection();
+
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        auto data = std::make_unique<uint8_t[]>(len);
+        memset(data.get(), static_cast<int>(i % 256), len);
+        conn1->send(std::move(data), len, true, true);
+    }
+
+    server_loop->stop(std::chrono::seconds(10));
+    server_loop->wait();
+
+    EXPECT_FALSE(server->is_valid());
+    EXPECT_FALSE(conn1->is_valid());
+
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        std::optional<message_in_t> msg;
+
+        while (!msg) {
+            msg = conn2->receive();
+        }
+
+        ASSERT_EQ(len, msg->length);
+        ASSERT_EQ(i % 256, msg->data[len - 1]);
+
+        delete[] msg->data;
+    }
+
+    server = nullptr;
+    conn1 = conn2 = nullptr;
+}
+
+TEST(ReadBudgetTest, send_many) {
+    constexpr uint16_t PORT = 62127;
+    constexpr uint32_t num_messages = 1000;
+    constexpr uint32_t len = 10000;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.read_budget = 1;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    // conn1 is edge-triggered, conn2 is not
+    auto conn1 = loop->allocate_event_listener<Connection>();
+    auto server = loop->make_event_listener<EdgeTriggeredServer>(addr, conn1);
+    auto conn2 = loop->make_event_listener<Connection>(addr, ProtocolType::TCP);
+
+    conn1->wait_for_connection();
+    conn2->wait_for_connection();
+
+    for (uint32_t i = 0; i < num_messages; ++i) {
+        auto data = std::make_unique<uint8_t[]>(len);
+        memset(data.get(), static_cast<int>(i % 256), len);
+        conn2->send(std::move(data), len, true);
+
+        auto other = std::make_unique<uint8_t[]>(len);
+        memset(other.get(), static_cast<int>(i % 256), len);
+        conn1->send(std::move(other), len, true);
+    }
+
+    for (auto &receiver : {conn1, conn2}) {
+        for (uint32_t i = 0; i < num_messages; ++i) {
+            std::optional<message_in_t> msg;
+
+            while (!msg) {
+                msg = receiver->receive();
+            }
+
+            ASSERT_EQ(len, msg->length);
+            ASSERT_EQ(i % 256, msg->data[len - 1]);
+
+            delete[] msg->data;
+        }
+    }
+
+    server = nullptr;
+    conn1 = conn2 = nullptr;
+}
+
+class ConnectingConnection : public Connection {
+  public:
+    void on_connected() override { m_connected += 1; }
+    void on_connect_failed() override { m_failed += 1; }
+
+    std::atomic<int> m_connected = 0;
+    std::atomic<int> m_failed = 0;
+};
+
+TEST(AsyncConnectTest, connect_many) {
+    constexpr uint16_t PORT = 62128;
+    constexpr int num_connections = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    std::atomic<int> count = 0;
+    auto acceptor = loop->make_event_listener<ReusePortAcceptor>(addr, count);
+
+    std::vector<std::shared_ptr<ConnectingConnection>> connections;
+
+    for (int i = 0; i < num_connections; ++i) {
+        auto conn = loop->allocate_event_listener<ConnectingConnection>();
+        ASSERT_TRUE(conn->connect_async(std::make_unique<TcpSocket>(), addr,
+                                        std::chrono::seconds(10)));
+
+        loop->register_event_listener(conn);
+        connections.push_back(conn);
+    }
+
+    for (auto &conn : connections) {
+        while (conn->m_connected == 0) {
+            std::this_thread::yield();
+        }
+
+        EXPECT_TRUE(conn->is_connected());
+        EXPECT_FALSE(conn->is_connecting());
+        EXPECT_EQ(0, conn->m_failed);
+    }
+
+    acceptor = nullptr;
+    connections.clear();
+}
+
+TEST(BusyPollTest, set_busy_poll) {
+    constexpr uint16_t PORT = 62137;
+
+    const Address addr = resolve_URL("localhost", PORT);
+
+    TcpSocket server;
+    ASSERT_TRUE(server.listen(addr, 10));
+
+    TcpSocket socket;
+    ASSERT_TRUE(socket.connect(addr));
+
+    if (!socket.set_busy_poll(50)) {
+        GTEST_SKIP() << "Not allowed to set SO_BUSY_POLL";
+    }
+
+    int value = 0;
+    socklen_t len = sizeof(value);
+
+    ASSERT_EQ(0, getsockopt(socket.get_fileno(), SOL_SOCKET, SO_BUSY_POLL,
+                            &value, &len));
+    EXPECT_EQ(50, value);
+
+    ASSERT_TRUE(socket.set_busy_poll(0));
+    ASSERT_EQ(0, getsockopt(socket.get_fileno(), SOL_SOCKET, SO_BUSY_POLL,
+                            &value, &len));
+    EXPECT_EQ(0, value);
+}
+
+TEST(BusyPollTest, invalid_socket) {
+    TcpSocket socket;
+    EXPECT_THROW(socket.set_busy_poll(50), socket_error);
+}
+
+TEST(AsyncConnectTest, timeout) {
+    constexpr uint16_t PORT = 62135;
+    constexpr auto timeout = std::chrono::milliseconds(100);
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    // Nobody accepts on this socket. Once its (single-entry) backlog is
+    // full, the kernel drops further connection requests without answering
+    TcpSocket server;
+    ASSERT_TRUE(server.listen(addr, 0));
+
+    TcpSocket filler;
+    ASSERT_TRUE(filler.connect(addr));
+
+    auto conn = loop->allocate_event_listener<ConnectingConnection>();
+    const auto start = std::chrono::steady_clock::now();
+
+    ASSERT_TRUE(
+        conn->connect_async(std::make_unique<TcpSocket>(), addr, timeout));
+    loop->register_event_listener(conn);
+
+    while (conn->m_failed == 0) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, timeout);
+
+    // Give the event loop a chance to report the failure again
+    std::this_thread::sleep_for(timeout);
+
+    EXPECT_EQ(1, conn->m_failed);
+    EXPECT_EQ(0, conn->m_connected);
+    EXPECT_FALSE(conn->is_connecting());
+    EXPECT_FALSE(conn->is_valid());
+}
+
+TEST(AsyncConnectTest, connection_refused) {
+    // Nobody listens on this port
+    constexpr uint16_t PORT = 62129;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+    const Address addr = resolve_URL("localhost", PORT);
+
+    auto conn = loop->allocate_event_listener<ConnectingConnection>();
+
+    if (conn->connect_async(std::make_unique<TcpSocket>(), addr,
+                            std::chrono::seconds(10))) {
+        loop->register_event_listener(conn);
+
+        while (conn->m_failed == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_EQ(0, conn->m_connected);
+    EXPECT_FALSE(conn->is_connecting());
+    EXPECT_FALSE(conn->is_valid());
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <yael/Stats.h>
+
+using namespace yael;
+
+class StatsTest : public testing::Test {};
+
+TEST(StatsTest, bucket_bounds) {
+    for (uint64_t value : {0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 1000ULL,
+                           123456789ULL, ~0ULL}) {
+        auto bucket = Histogram::get_bucket(value);
+
+        ASSERT_LT(bucket, Histogram::NUM_BUCKETS);
+        EXPECT_GE(Histogram::get_bucket_upper_bound(bucket), value);
+
+        if (bucket > 0) {
+            EXPECT_LT(Histogram::get_bucket_upper_bound(bucket - 1), value);
+        }
+    }
+}
+
+TEST(StatsTest, percentiles) {
+    Histogram hist;
+
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        hist.record(value);
+    }
+
+    EXPECT_EQ(1000U, hist.count());
+    EXPECT_EQ(1000U, hist.max());
+    EXPECT_DOUBLE_EQ(500.5, hist.mean());
+
+    // Values are accurate within 1/16
+    auto median = hist.percentile(50.0);
+    EXPECT_GE(median, 500U);
+    EXPECT_LE(median, 500U + 500U / 16);
+
+    EXPECT_EQ(1000U, hist.percentile(100.0));
+    EXPECT_EQ(1U, hist.percentile(0.0));
+}
+
+TEST(StatsTest, merge) {
+    worker_stats_t stats1;
+    stats1.events = 2;
+    stats1.handler_time.record(10);
+    stats1.handler_time.record(20);
+
+    worker_stats_t stats2;
+    stats2.events = 1;
+    stats2.handler_time.record(5000);
+
+    event_loop_stats_t loop_stats;
+    loop_stats.workers = {stats1, stats2};
+
+    auto total = loop_stats.total();
+
+    EXPECT_EQ(3U, total.events);
+    EXPECT_EQ(3U, total.handler_time.count());
+    EXPECT_EQ(5000U, total.handler_time.max());
+}
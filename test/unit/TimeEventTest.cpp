@@ -2,6 +2,11 @@
 #include <yael/EventLoop.h>
 #include <yael/TimeEventListener.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 using namespace yael;
 
 class TimeEventTest : public testing::Test {};
@@ -13,7 +18,7 @@ class TestTimeListener : public TimeEventListener {
     int get_count() { return count; }
 
   private:
-    volatile int count = 0;
+    std::atomic<int> count = 0;
 };
 
 class TestTimeListener2 : public TimeEventListener {
@@ -28,7 +33,7 @@ class TestTimeListener2 : public TimeEventListener {
     int get_count() { return count; }
 
   private:
-    volatile int count = 0;
+    std::atomic<int> count = 0;
 };
 
 TEST(TimeEventTest, multi_schedule) {
@@ -127,3 +132,164 @@ TEST(TimeEventTest, schedule_three2) {
 
     EXPECT_EQ(3U, hdl->get_count());
 }
+
+class RecordingTimeListener : public TimeEventListener {
+  public:
+    explicit RecordingTimeListener(std::atomic<int> &count) : m_count(count) {}
+
+    void on_time_event() override {
+        fired_at = std::chrono::steady_clock::now();
+        m_count += 1;
+    }
+
+    std::chrono::steady_clock::time_point fired_at;
+
+  private:
+    std::atomic<int> &m_count;
+};
+
+TEST(TimeEventTest, many_listeners) {
+    constexpr int num_listeners = 10'000;
+
+    event_loop_config_t config;
+    config.num_threads = 4;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> count = 0;
+    std::vector<std::shared_ptr<RecordingTimeListener>> listeners;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Spread over multiple levels of the timing wheel
+    for (int i = 0; i < num_listeners; ++i) {
+        auto hdl = loop->make_event_listener<RecordingTimeListener>(count);
+        hdl->schedule(static_cast<uint64_t>(i % 300));
+        listeners.push_back(hdl);
+    }
+
+    while (count < num_listeners) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < num_listeners; ++i) {
+        EXPECT_GE(listeners[i]->fired_at - start,
+                  std::chrono::milliseconds(i % 300));
+    }
+
+    loop->stop();
+    loop->wait();
+
+    for (auto &listener : listeners) {
+        EXPECT_EQ(nullptr, listener->event_loop());
+    }
+}
+
+TEST(TimeEventTest, unschedule) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> count = 0;
+    std::atomic<int> other_count = 0;
+
+    auto hdl = loop->make_event_listener<RecordingTimeListener>(count);
+    auto other = loop->make_event_listener<RecordingTimeListener>(other_count);
+
+    hdl->schedule(20);
+    hdl->schedule(70'000);
+    other->schedule(50);
+
+    EXPECT_TRUE(hdl->unschedule());
+    EXPECT_FALSE(hdl->unschedule());
+
+    while (other_count < 1) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(0, count);
+
+    loop->stop();
+    loop->wait();
+}
+
+class PacingTimeListener : public TimeEventListener {
+  public:
+    PacingTimeListener(std::atomic<int> &count, int num_events)
+        : m_count(count), m_num_events(num_events) {}
+
+    void on_time_event() override {
+        if (m_count.fetch_add(1) + 1 < m_num_events) {
+            schedule(std::chrono::microseconds(100));
+        }
+    }
+
+  private:
+    std::atomic<int> &m_count;
+    const int m_num_events;
+};
+
+TEST(TimeEventTest, sub_millisecond) {
+    constexpr int num_events = 20;
+
+    event_loop_config_t config;
+    config.num_threads = 2;
+    config.timer_resolution = std::chrono::microseconds(10);
+
+    auto loop = EventLoop::create(config);
+
+    std::atomic<int> count = 0;
+    std::atomic<int> at_count = 0;
+
+    auto pacer =
+        loop->make_event_listener<PacingTimeListener>(count, num_events);
+    auto hdl = loop->make_event_listener<RecordingTimeListener>(at_count);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::microseconds(300);
+
+    pacer->schedule(std::chrono::microseconds(100));
+    hdl->schedule_at(deadline);
+
+    while (count < num_events || at_count < 1) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::microseconds(100 * num_events));
+    EXPECT_GE(hdl->fired_at, deadline);
+
+    loop->stop();
+    loop->wait();
+}
+
+TEST(TimeEventTest, drain_pending_events) {
+    event_loop_config_t config;
+    config.num_threads = 2;
+
+    auto loop = EventLoop::create(config);
+
+    auto due = loop->make_event_listener<TestTimeListener>();
+    due->schedule(50);
+
+    // Not due before the deadline, so it does not hold up stopping
+    auto late = loop->make_event_listener<TestTimeListener>();
+    late->schedule(60 * 1000);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    loop->stop(std::chrono::seconds(10));
+    loop->wait();
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+    EXPECT_LT(elapsed, std::chrono::seconds(5));
+
+    EXPECT_EQ(1, due->get_count());
+    EXPECT_EQ(0, late->get_count());
+
+    EXPECT_FALSE(due->is_valid());
+    EXPECT_FALSE(late->is_valid());
+}
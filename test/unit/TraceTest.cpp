@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <yael/EventLoop.h>
+#include <yael/TimeEventListener.h>
+#include <yael/Trace.h>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+using namespace yael;
+
+class TraceTest : public testing::Test {};
+
+namespace {
+
+size_t count_occurrences(const std::string &str, const std::string &pattern) {
+    size_t count = 0;
+    size_t pos = str.find(pattern);
+
+    while (pos != std::string::npos) {
+        count++;
+        pos = str.find(pattern, pos + pattern.size());
+    }
+
+    return count;
+}
+
+class TracedTimeListener : public TimeEventListener {
+  public:
+    void on_time_event() override { done = true; }
+
+    std::atomic<bool> done = false;
+};
+
+} // namespace
+
+TEST(TraceTest, ring_keeps_latest) {
+    trace::enable(4);
+
+    // Needs a new thread, so the ring size applies
+    std::thread thread([]() {
+        for (int i = 0; i < 10; ++i) {
+            const trace::Span span("ring_keeps_latest", i);
+        }
+    });
+    thread.join();
+
+    trace::disable();
+
+    std::stringstream sstr;
+    trace::write_chrome_trace(sstr);
+    auto output = sstr.str();
+
+    EXPECT_EQ(0U, output.find("{\"traceEvents\":["));
+    EXPECT_EQ(4U, count_occurrences(output, "\"ring_keeps_latest\""));
+    EXPECT_EQ(1U, count_occurrences(output, "\"fd\":9}"));
+    EXPECT_EQ(0U, count_occurrences(output, "\"fd\":5}"));
+}
+
+TEST(TraceTest, reuse_rings_of_terminated_threads) {
+    trace::enable(8);
+
+    for (int i = 0; i < 10; ++i) {
+        std::thread thread([i]() {
+            const trace::Span span("reuse_rings_of_terminated_threads", i);
+        });
+        thread.join();
+    }
+
+    trace::disable();
+
+    std::stringstream sstr;
+    trace::write_chrome_trace(sstr);
+    auto output = sstr.str();
+
+    // All threads shared a single ring, which only keeps the last one's spans
+    EXPECT_EQ(1U, count_occurrences(output,
+                                    "\"reuse_rings_of_terminated_threads\""));
+    EXPECT_EQ(1U, count_occurrences(output, "\"fd\":9}"));
+}
+
+TEST(TraceTest, disabled) {
+    {
+        const trace::Span span("trace_disabled");
+    }
+
+    std::stringstream sstr;
+    trace::write_chrome_trace(sstr);
+
+    EXPECT_EQ(0U, count_occurrences(sstr.str(), "trace_disabled"));
+}
+
+TEST(TraceTest, event_loop_spans) {
+    trace::enable();
+
+    event_loop_config_t config;
+    config.num_threads = 1;
+
+    auto loop = EventLoop::create(config);
+
+    auto listener = loop->make_event_listener<TracedTimeListener>();
+    listener->schedule(1);
+
+    while (!listener->done) {
+        // pass
+    }
+
+    loop->stop();
+    loop->wait();
+
+    trace::disable();
+
+    std::stringstream sstr;
+    trace::write_chrome_trace(sstr);
+    auto output = sstr.str();
+
+    EXPECT_GE(count_occurrences(output, "\"on_read_ready\""), 1U);
+    EXPECT_GE(count_occurrences(output, "\"wait\""), 1U);
+}